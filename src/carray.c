@@ -1,6 +1,16 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <math.h>
+#include <float.h>
+
+#if !defined(WIN32) && !defined(_WIN32)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <sys/uio.h>
+#endif
 
 #define CARRAY_CAPI_IMPLEMENT_SET_CAPI 1
 #define CARRAY_CAPI_IMPLEMENT_GET_CAPI 1
@@ -9,6 +19,13 @@
 #include "carray.h"
 #include "carray_capi_impl.h"
 
+#if defined(__F16C__) && defined(__AVX__)
+#  include <immintrin.h>
+#  define CARRAY_USE_F16C 1
+#else
+#  define CARRAY_USE_F16C 0
+#endif
+
 /* ============================================================================================ */
 
 const char* const CARRAY_CLASS_NAME = "carray";
@@ -70,7 +87,10 @@ enum ElementType
     TYPE_UINT64,
     
     TYPE_FLOAT32,
-    TYPE_FLOAT64
+    TYPE_FLOAT64,
+    
+    TYPE_FLOAT16,
+    TYPE_BFLOAT16
 };
 
 static const char* const elementTypeNames[] =
@@ -127,6 +147,9 @@ static const char* const elementTypeNames[] =
     "float32",
     "float64",
     
+    "float16",
+    "bfloat16",
+    
     NULL
 };
 
@@ -134,18 +157,14 @@ static const char* const elementTypeNames[] =
 
 #define CHARSIZE(bits) (bits + CHAR_BIT - 1)/CHAR_BIT
 
-static int Carray_new(lua_State* L)
+/**
+ * Evaluates the element type name at the given stack index, see elementTypeNames.
+ * Returns 0 if there is no corresponding element type on this platform.
+ */
+static carray_type checkElementType(lua_State* L, int typeArg)
 {
-    int arg = 1;
-
-    int typeArg = arg++;
     ElementType elementType = luaL_checkoption(L, typeArg, NULL, elementTypeNames);
 
-    size_t elementCount = 0;
-    if (!lua_isnoneornil(L, arg)) {
-        elementCount = luaL_checkinteger(L, arg++);
-    }
-
     bool   isInteger   = false;
     bool   isUnsigned  = false;
     size_t elementSize = 0;
@@ -204,6 +223,9 @@ static int Carray_new(lua_State* L)
         
         case TYPE_FLOAT32: elementSize = CHARSIZE(32); break;
         case TYPE_FLOAT64: elementSize = CHARSIZE(64); break;
+        
+        case TYPE_FLOAT16:  normalizedType = CARRAY_HALF;     elementSize = 2; break;
+        case TYPE_BFLOAT16: normalizedType = CARRAY_BFLOAT16; elementSize = 2; break;
     }
     if (!normalizedType) {
         if (isInteger) {
@@ -244,14 +266,96 @@ static int Carray_new(lua_State* L)
                 }
         }
     }
+    return elementSize > 0 ? normalizedType : 0;
+}
+
+/* ============================================================================================ */
+
+#define CARRAY_MAX_DIMS 32
+
+/**
+ * Reads dimension sizes given as table at arg or as integer arguments
+ * from arg to the top of the stack. If elementCount is not NULL, one 
+ * dimension may be -1 and is inferred from *elementCount. Returns the
+ * number of dimensions, the element count is stored in *total.
+ */
+static size_t checkShape(lua_State* L, int arg, const size_t* elementCount, 
+                         size_t* dims, size_t* total)
+{
+    bool   isTable = lua_istable(L, arg);
+    size_t ndims   = isTable ? lua_rawlen(L, arg) : (size_t)(lua_gettop(L) - arg + 1);
+    if (ndims > CARRAY_MAX_DIMS) {
+        luaL_argerror(L, arg, "too many dimensions");
+    }
+    size_t inferred = ndims;
+    size_t product  = 1;
+    for (size_t i = 0; i < ndims; ++i) {
+        lua_Integer d;
+        if (isTable) {
+            lua_rawgeti(L, arg, i + 1);
+            int isnum;
+            d = lua_tointegerx(L, -1, &isnum);
+            lua_pop(L, 1);
+            if (!isnum) {
+                luaL_argerror(L, arg, "integer dimensions expected");
+            }
+        } else {
+            d = luaL_checkinteger(L, arg + i);
+        }
+        if (d == -1 && elementCount && inferred == ndims) {
+            inferred = i;
+            dims[i]  = 1;
+        } else if (d < 0) {
+            luaL_argerror(L, isTable ? arg : arg + (int)i, "invalid dimension");
+        } else {
+            dims[i] = d;
+        }
+        if (dims[i] != 0 && product > SIZE_MAX / dims[i]) {
+            luaL_argerror(L, arg, "shape too large");
+        }
+        product *= dims[i];
+    }
+    if (inferred < ndims) {
+        if (product == 0 || *elementCount % product != 0) {
+            luaL_argerror(L, arg, "shape does not match array length");
+        }
+        dims[inferred] = *elementCount / product;
+        product = *elementCount;
+    }
+    *total = product;
+    return ndims;
+}
+
+/* ============================================================================================ */
+
+static int Carray_new(lua_State* L)
+{
+    int arg = 1;
+
+    int typeArg = arg++;
+    carray_type normalizedType = checkElementType(L, typeArg);
+
+    size_t elementCount = 0;
+    size_t ndims        = 0;
+    size_t dims[CARRAY_MAX_DIMS];
+    if (lua_istable(L, arg)) {
+        ndims = checkShape(L, arg++, NULL, dims, &elementCount);
+    }
+    else if (!lua_isnoneornil(L, arg)) {
+        elementCount = luaL_checkinteger(L, arg++);
+    }
+
     carray* created = NULL;
     
-    if (normalizedType && elementSize > 0) {
+    if (normalizedType) {
         created = carray_capi_impl.newCarray(L, normalizedType, CARRAY_DEFAULT, elementCount, NULL);
     }
     if (!created) {
         return luaL_error(L, "cannot create carray for type '%s'", lua_tostring(L, typeArg));
     }
+    if (!carray_set_shape(created, dims, ndims)) {
+        return luaL_error(L, "cannot allocate carray");
+    }
     return 1;
 }
 
@@ -274,6 +378,9 @@ static CarrayUserData* checkWritableUdata(lua_State* L, int index)
 {
     CarrayUserData* udata = checkReadableUdata(L, index);
     if (!(udata->impl->attr & CARRAY_READONLY)) {
+        if (!carray_unshare(udata->impl)) {
+            luaL_error(L, "cannot allocate carray");
+        }
         return udata;
     } else {
         luaL_argerror(L, index, "carray is not writable");
@@ -283,33 +390,41 @@ static CarrayUserData* checkWritableUdata(lua_State* L, int index)
 
 /* ============================================================================================ */
 
-static const char* typeToString(carray* impl)
+static const char* elementTypeToString(carray_type elementType)
 {
-    if (impl) {
-        switch (impl->elementType) {
-            case CARRAY_UCHAR:   return "unsigned char";
-            case CARRAY_SCHAR:   return "signed char";
-            
-            case CARRAY_SHORT:   return "short";
-            case CARRAY_USHORT:  return "unsigned short";
-            
-            case CARRAY_INT:     return "int";
-            case CARRAY_UINT:    return "unsigned int";
-            
-            case CARRAY_LONG:    return "long";
-            case CARRAY_ULONG:   return "unsigned long";
-            
+    switch (elementType) {
+        case CARRAY_UCHAR:   return "unsigned char";
+        case CARRAY_SCHAR:   return "signed char";
+        
+        case CARRAY_SHORT:   return "short";
+        case CARRAY_USHORT:  return "unsigned short";
+        
+        case CARRAY_INT:     return "int";
+        case CARRAY_UINT:    return "unsigned int";
+        
+        case CARRAY_LONG:    return "long";
+        case CARRAY_ULONG:   return "unsigned long";
+        
 #if CARRAY_CAPI_HAVE_LONG_LONG
-            case CARRAY_LLONG:   return "long long";
-            case CARRAY_ULLONG:  return "unsigned long long";
+        case CARRAY_LLONG:   return "long long";
+        case CARRAY_ULLONG:  return "unsigned long long";
 #endif
-            case CARRAY_FLOAT:   return "float";
-            case CARRAY_DOUBLE:  return "double";
-            
-        }
+        case CARRAY_FLOAT:   return "float";
+        case CARRAY_DOUBLE:  return "double";
+        
+        case CARRAY_HALF:     return "float16";
+        case CARRAY_BFLOAT16: return "bfloat16";
     }
     return "?";
 }
+
+/* ============================================================================================ */
+
+static const char* typeToString(carray* impl)
+{
+    return impl ? elementTypeToString(impl->elementType) : "?";
+}
+
 /* ============================================================================================ */
 
 static const char* baseTypeToString(carray* impl)
@@ -335,7 +450,10 @@ static const char* baseTypeToString(carray* impl)
                                  return "int";
                                  
             case CARRAY_FLOAT:   
-            case CARRAY_DOUBLE:  return "float";
+            case CARRAY_DOUBLE:  
+            case CARRAY_HALF:    
+            case CARRAY_BFLOAT16:
+                                 return "float";
             
         }
     }
@@ -344,6 +462,526 @@ static const char* baseTypeToString(carray* impl)
 
 /* ============================================================================================ */
 
+/**
+ * Invokes M(carrayType, cType, unsignedType, name) for each element type.
+ * unsignedType is the unsigned counterpart of cType for integer types and
+ * is used for wrap-around arithmetic without undefined behaviour.
+ */
+
+#if CARRAY_CAPI_HAVE_LONG_LONG
+#  define CARRAY_FOR_LLONG_TYPES(M) \
+        M(CARRAY_LLONG,  long long,          unsigned long long, llong)  \
+        M(CARRAY_ULLONG, unsigned long long, unsigned long long, ullong)
+#else
+#  define CARRAY_FOR_LLONG_TYPES(M)
+#endif
+
+#define CARRAY_FOR_INTEGER_TYPES(M) \
+        M(CARRAY_UCHAR,  unsigned char,      unsigned char,      uchar)  \
+        M(CARRAY_SCHAR,  signed char,        unsigned char,      schar)  \
+        M(CARRAY_SHORT,  short,              unsigned short,     short)  \
+        M(CARRAY_USHORT, unsigned short,     unsigned short,     ushort) \
+        M(CARRAY_INT,    int,                unsigned int,       int)    \
+        M(CARRAY_UINT,   unsigned int,       unsigned int,       uint)   \
+        M(CARRAY_LONG,   long,               unsigned long,      long)   \
+        M(CARRAY_ULONG,  unsigned long,      unsigned long,      ulong)  \
+        CARRAY_FOR_LLONG_TYPES(M)
+
+#define CARRAY_FOR_FLOAT_TYPES(M) \
+        M(CARRAY_FLOAT,  float,              float,              float)  \
+        M(CARRAY_DOUBLE, double,             double,             double)
+
+#define CARRAY_FOR_ALL_TYPES(M) \
+        CARRAY_FOR_INTEGER_TYPES(M) \
+        CARRAY_FOR_FLOAT_TYPES(M)
+
+/* ============================================================================================ */
+
+/**
+ * Evaluates the optional position arguments pos1 and pos2 at the stack index arg and arg + 1
+ * using the same conventions as array:get(), i.e. negative positions are counted from behind.
+ * pos1 defaults to 1 and pos2 defaults to -1. The range is clipped to the array bounds.
+ */
+static void checkRange(lua_State* L, int arg, size_t totalCount, size_t* offset, size_t* count)
+{
+    lua_Integer index1 = luaL_optinteger(L, arg,      1);
+    lua_Integer index2 = luaL_optinteger(L, arg + 1, -1);
+    if (index1 < 0) {
+        index1 = totalCount + index1 + 1;
+    }
+    if (index2 < 0) {
+        index2 = totalCount + index2 + 1;
+    }
+    if (index1 < 1) {
+        index1 = 1;
+    }
+    if (index2 > (lua_Integer)totalCount) {
+        index2 = totalCount;
+    }
+    if (index2 >= index1) {
+        *offset = index1 - 1;
+        *count  = index2 - index1 + 1;
+    } else {
+        *offset = 0;
+        *count  = 0;
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Pushes the destination array for functions that are producing a new array:
+ * if the value at stack index arg is nil, a new array is created, otherwise
+ * the given array must be writable and of the given element type.
+ * The destination array is resized to count elements.
+ */
+static carray* pushDestination(lua_State* L, int arg, carray_type elementType, size_t count)
+{
+    if (lua_isnoneornil(L, arg)) {
+        carray* created = carray_capi_impl.newCarray(L, elementType, CARRAY_DEFAULT, count, NULL);
+        if (!created) {
+            luaL_error(L, "cannot create carray");
+        }
+        return created;
+    }
+    carray* dst = checkWritableUdata(L, arg)->impl;
+    if (dst->elementType != elementType) {
+        luaL_argerror(L, arg, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, elementTypeToString(elementType)));
+    }
+    if (dst->elementCount != count) {
+        if (!carray_resize(dst, count, 0) && count > 0) {
+            luaL_argerror(L, arg, "resizing carray failed");
+        }
+    }
+    lua_pushvalue(L, arg);
+    return dst;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Like luaL_checkinteger(), but numbers with fractional part are also rejected for Lua
+ * versions without integer subtype, where luaL_checkinteger() truncates them.
+ */
+static lua_Integer checkInteger(lua_State* L, int arg)
+{
+    lua_Integer v = luaL_checkinteger(L, arg);
+#if LUA_VERSION_NUM < 503
+    if ((lua_Number)v != lua_tonumber(L, arg)) {
+        luaL_argerror(L, arg, "number has no integer representation");
+    }
+#endif
+    return v;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Limits the integer value v to the value range of the array's integer element type.
+ */
+static lua_Integer saturateInteger(carray* impl, lua_Integer v)
+{
+    size_t bits = impl->elementSize * CHAR_BIT;
+    if (bits < sizeof(lua_Integer) * CHAR_BIT) {
+        lua_Integer maxValue;
+        lua_Integer minValue;
+        if (impl->isUnsigned) {
+            maxValue = (((lua_Integer)1) << bits) - 1;
+            minValue = 0;
+        } else {
+            maxValue = (((lua_Integer)1) << (bits - 1)) - 1;
+            minValue = -maxValue - 1;
+        }
+        if      (v < minValue) v = minValue;
+        else if (v > maxValue) v = maxValue;
+    }
+    else if (impl->isUnsigned && v < 0) {
+        v = 0;
+    }
+    return v;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Second instance of the element type iteration for nesting inside CARRAY_FOR_*_TYPES():
+ * invokes M(E1, T1, U1, N1, carrayType, cType, unsignedType, name) for each element type
+ * with the given outer type parameters E1, T1, U1, N1.
+ */
+
+#if CARRAY_CAPI_HAVE_LONG_LONG
+#  define CARRAY_FOR_LLONG_TYPES_2(M, E1, T1, U1, N1) \
+        M(E1, T1, U1, N1, CARRAY_LLONG,  long long,          unsigned long long, llong)  \
+        M(E1, T1, U1, N1, CARRAY_ULLONG, unsigned long long, unsigned long long, ullong)
+#else
+#  define CARRAY_FOR_LLONG_TYPES_2(M, E1, T1, U1, N1)
+#endif
+
+#define CARRAY_FOR_INTEGER_TYPES_2(M, E1, T1, U1, N1) \
+        M(E1, T1, U1, N1, CARRAY_UCHAR,  unsigned char,      unsigned char,      uchar)  \
+        M(E1, T1, U1, N1, CARRAY_SCHAR,  signed char,        unsigned char,      schar)  \
+        M(E1, T1, U1, N1, CARRAY_SHORT,  short,              unsigned short,     short)  \
+        M(E1, T1, U1, N1, CARRAY_USHORT, unsigned short,     unsigned short,     ushort) \
+        M(E1, T1, U1, N1, CARRAY_INT,    int,                unsigned int,       int)    \
+        M(E1, T1, U1, N1, CARRAY_UINT,   unsigned int,       unsigned int,       uint)   \
+        M(E1, T1, U1, N1, CARRAY_LONG,   long,               unsigned long,      long)   \
+        M(E1, T1, U1, N1, CARRAY_ULONG,  unsigned long,      unsigned long,      ulong)  \
+        CARRAY_FOR_LLONG_TYPES_2(M, E1, T1, U1, N1)
+
+#define CARRAY_FOR_FLOAT_TYPES_2(M, E1, T1, U1, N1) \
+        M(E1, T1, U1, N1, CARRAY_FLOAT,  float,              float,              float)  \
+        M(E1, T1, U1, N1, CARRAY_DOUBLE, double,             double,             double)
+
+#define CARRAY_FOR_ALL_TYPES_2(M, E1, T1, U1, N1) \
+        CARRAY_FOR_INTEGER_TYPES_2(M, E1, T1, U1, N1) \
+        CARRAY_FOR_FLOAT_TYPES_2(M, E1, T1, U1, N1)
+
+/* ============================================================================================ */
+
+#if CARRAY_CAPI_HAVE_LONG_LONG
+    typedef long long          MaxInt;
+    typedef unsigned long long MaxUInt;
+#   define CARRAY_MAXINT       CARRAY_LLONG
+#   define CARRAY_MAXUINT      CARRAY_ULLONG
+#else
+    typedef long               MaxInt;
+    typedef unsigned long      MaxUInt;
+#   define CARRAY_MAXINT       CARRAY_LONG
+#   define CARRAY_MAXUINT      CARRAY_ULONG
+#endif
+
+/* value range of integer type T with unsigned counterpart U */
+#define CARRAY_MAXOF(T, U) ((T)-1 < (T)1 ? (T)((U)-1 >> 1) : (T)-1)
+#define CARRAY_MINOF(T, U) ((T)-1 < (T)1 ? (T)(-CARRAY_MAXOF(T, U) - 1) : (T)0)
+
+/**
+ * Element type conversion kernels convert_<src>_<dst>(). 
+ * Float to integer conversion always saturates (NaN is converted to zero), because
+ * out of range values are undefined behaviour in C. Integer to integer conversion 
+ * saturates if requested, otherwise values are truncated to the destination bit width.
+ */
+#define CARRAY_CONVERT_INTEGER_TO_INTEGER(ED, TD, UD, ND, ES, TS, US, NS) \
+    static CARRAY_VECTORIZE void convert_##NS##_##ND(TD* d, const TS* s, size_t n, bool saturate) \
+    { \
+        size_t i; \
+        if (saturate) { \
+            /* bounds as variables: avoids -Wtype-limits for always true/false comparisons */ \
+            const TS      zero = 0; \
+            const MaxInt  dmin = (MaxInt)CARRAY_MINOF(TD, UD); \
+            const MaxUInt dmax = (MaxUInt)CARRAY_MAXOF(TD, UD); \
+            for (i = 0; i < n; ++i) { \
+                TS v = s[i]; \
+                d[i] = (v < zero) ? (((MaxInt)v  < dmin) ? CARRAY_MINOF(TD, UD) : (TD)v) \
+                                  : (((MaxUInt)v > dmax) ? CARRAY_MAXOF(TD, UD) : (TD)v); \
+            } \
+        } else { \
+            for (i = 0; i < n; ++i) d[i] = (TD)s[i]; \
+        } \
+    }
+
+#define CARRAY_CONVERT_FLOAT_TO_INTEGER(ED, TD, UD, ND, ES, TS, US, NS) \
+    static CARRAY_VECTORIZE void convert_##NS##_##ND(TD* d, const TS* s, size_t n, bool saturate) \
+    { \
+        size_t i; \
+        (void)saturate; \
+        for (i = 0; i < n; ++i) { \
+            TS v = s[i]; \
+            d[i] = (v != v)                           ? (TD)0 \
+                 : (v <= (TS)CARRAY_MINOF(TD, UD)) ? CARRAY_MINOF(TD, UD) \
+                 : (v >= (TS)CARRAY_MAXOF(TD, UD)) ? CARRAY_MAXOF(TD, UD) \
+                 : (TD)v; \
+        } \
+    }
+
+#define CARRAY_CONVERT_TO_FLOAT(ED, TD, UD, ND, ES, TS, US, NS) \
+    static CARRAY_VECTORIZE void convert_##NS##_##ND(TD* d, const TS* s, size_t n, bool saturate) \
+    { \
+        size_t i; \
+        (void)saturate; \
+        for (i = 0; i < n; ++i) d[i] = (TD)s[i]; \
+    }
+
+#define CARRAY_CONVERT_TO_INTEGER(ED, TD, UD, ND) \
+        CARRAY_FOR_INTEGER_TYPES_2(CARRAY_CONVERT_INTEGER_TO_INTEGER, ED, TD, UD, ND) \
+        CARRAY_FOR_FLOAT_TYPES_2(CARRAY_CONVERT_FLOAT_TO_INTEGER, ED, TD, UD, ND)
+
+#define CARRAY_CONVERT_TO_FLOATS(ED, TD, UD, ND) \
+        CARRAY_FOR_ALL_TYPES_2(CARRAY_CONVERT_TO_FLOAT, ED, TD, UD, ND)
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_CONVERT_TO_INTEGER)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_CONVERT_TO_FLOATS)
+
+/**
+ * scale_<src>(): d[i] = s[i] * scale + offset as double values
+ */
+#define CARRAY_SCALE_KERNEL(E, T, U, N) \
+    static CARRAY_VECTORIZE void scale_##N(double* d, const T* s, size_t n, double scale, double offset) \
+    { \
+        size_t i; \
+        for (i = 0; i < n; ++i) d[i] = s[i] * scale + offset; \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_SCALE_KERNEL)
+
+/* ============================================================================================ */
+
+/**
+ * 16-bit floating point element types CARRAY_HALF (IEEE 754 binary16) and CARRAY_BFLOAT16 
+ * (upper half of a float) are stored as unsigned short. Float values are converted with 
+ * round to nearest even, NaN values remain NaN.
+ */
+typedef char CarrayCheckHalfSize[(sizeof(unsigned short) == 2 && sizeof(float) == sizeof(unsigned int)) ? 1 : -1];
+
+#define CARRAY_IS_HALF(elementType) ((elementType) == CARRAY_HALF || (elementType) == CARRAY_BFLOAT16)
+
+static CARRAY_INLINE float halfToFloat(unsigned short h)
+{
+    const unsigned int shiftedExp = 0x7C00u << 13;
+    const unsigned int magicBits  = 113u << 23;
+    unsigned int o   = (unsigned int)(h & 0x7FFF) << 13;
+    unsigned int exp = o & shiftedExp;
+    float f, magic;
+    o += (127u - 15u) << 23;
+    if (exp == shiftedExp) {
+        /* Inf or NaN */
+        o += (128u - 16u) << 23;
+    } else if (exp == 0) {
+        /* zero or subnormal */
+        o += 1u << 23;
+        memcpy(&f,     &o,         sizeof(f));
+        memcpy(&magic, &magicBits, sizeof(magic));
+        f -= magic;
+        memcpy(&o,     &f,         sizeof(o));
+    }
+    o |= (unsigned int)(h & 0x8000) << 16;
+    memcpy(&f, &o, sizeof(f));
+    return f;
+}
+
+static CARRAY_INLINE unsigned short floatToHalf(float f)
+{
+    const unsigned int infBits    = 255u << 23;
+    const unsigned int maxBits    = (127u + 16u) << 23;
+    const unsigned int denormBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    unsigned int u, o, sign;
+    memcpy(&u, &f, sizeof(u));
+    sign = u & 0x80000000u;
+    u   ^= sign;
+    if (u >= maxBits) {
+        /* Inf, NaN (quieted, upper payload bits are kept) or overflow */
+        o = (u > infBits) ? (0x7E00 | ((u >> 13) & 0x3FF)) : 0x7C00;
+    } else if (u < (113u << 23)) {
+        /* subnormal or zero */
+        float denorm;
+        memcpy(&denorm, &denormBits, sizeof(denorm));
+        memcpy(&f, &u, sizeof(f));
+        f += denorm;
+        memcpy(&u, &f, sizeof(u));
+        o = u - denormBits;
+    } else {
+        unsigned int odd = (u >> 13) & 1;
+        u += ((unsigned int)(15 - 127) << 23) + 0xFFF + odd;
+        o  = u >> 13;
+    }
+    return (unsigned short)(o | (sign >> 16));
+}
+
+static CARRAY_INLINE float bfloat16ToFloat(unsigned short h)
+{
+    unsigned int u = (unsigned int)h << 16;
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+static CARRAY_INLINE unsigned short floatToBfloat16(float f)
+{
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    if ((u & 0x7FFFFFFFu) > 0x7F800000u) {
+        /* quiet NaN */
+        return (unsigned short)((u >> 16) | 0x0040);
+    }
+    u += 0x7FFFu + ((u >> 16) & 1);
+    return (unsigned short)(u >> 16);
+}
+
+/**
+ * Bulk conversion between 16-bit floating point elements and float. The F16C
+ * instructions are used for CARRAY_HALF if the compiler targets them.
+ */
+static CARRAY_VECTORIZE void halfToFloats(carray_type srcType, float* d, const unsigned short* s, size_t n)
+{
+    size_t i = 0;
+    if (srcType == CARRAY_HALF) {
+#if CARRAY_USE_F16C
+        for (; i + 8 <= n; i += 8) {
+            _mm256_storeu_ps(d + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(s + i))));
+        }
+#endif
+        for (; i < n; ++i) d[i] = halfToFloat(s[i]);
+    } else {
+        for (; i < n; ++i) d[i] = bfloat16ToFloat(s[i]);
+    }
+}
+
+static CARRAY_VECTORIZE void floatsToHalf(carray_type dstType, unsigned short* d, const float* s, size_t n)
+{
+    size_t i = 0;
+    if (dstType == CARRAY_HALF) {
+#if CARRAY_USE_F16C
+        for (; i + 8 <= n; i += 8) {
+            _mm_storeu_si128((__m128i*)(d + i), _mm256_cvtps_ph(_mm256_loadu_ps(s + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+#endif
+        for (; i < n; ++i) d[i] = floatToHalf(s[i]);
+    } else {
+        for (; i < n; ++i) d[i] = floatToBfloat16(s[i]);
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Returns the size of the given element type or 0 for unknown element types.
+ */
+static size_t elementTypeSize(carray_type elementType)
+{
+    switch (elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: return sizeof(T);
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: return sizeof(unsigned short);
+        default:              return 0;
+    }
+}
+
+/* ============================================================================================ */
+
+/* number of elements that are converted in one step via an intermediate buffer */
+#define CARRAY_CONVERT_CHUNK 256
+
+static bool convertElements(carray_type dstType, void* d, carray_type srcType, const void* s, size_t n, bool saturate);
+
+/**
+ * Converts n elements from or to a 16-bit floating point type via float.
+ */
+static bool convertHalfElements(carray_type dstType, void* d, carray_type srcType, const void* s, size_t n, bool saturate)
+{
+    float  buffer[CARRAY_CONVERT_CHUNK];
+    size_t dstSize = elementTypeSize(dstType);
+    size_t srcSize = elementTypeSize(srcType);
+    if (dstSize == 0 || srcSize == 0) {
+        return false;
+    }
+    while (n > 0) {
+        size_t m = (n < CARRAY_CONVERT_CHUNK) ? n : CARRAY_CONVERT_CHUNK;
+        if (CARRAY_IS_HALF(srcType)) {
+            halfToFloats(srcType, buffer, s, m);
+        } else {
+            convertElements(CARRAY_FLOAT, buffer, srcType, s, m, saturate);
+        }
+        if (CARRAY_IS_HALF(dstType)) {
+            floatsToHalf(dstType, d, buffer, m);
+        } else {
+            convertElements(dstType, d, CARRAY_FLOAT, buffer, m, saturate);
+        }
+        d  = ((char*)d)       + m * dstSize;
+        s  = ((const char*)s) + m * srcSize;
+        n -= m;
+    }
+    return true;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Converts n elements from source type to destination type.
+ * Returns false for unknown element types.
+ */
+static bool convertElements(carray_type dstType, void* d, carray_type srcType, const void* s, size_t n, bool saturate)
+{
+    if (CARRAY_IS_HALF(dstType) || CARRAY_IS_HALF(srcType)) {
+        return convertHalfElements(dstType, d, srcType, s, n, saturate);
+    }
+    switch (dstType) {
+#define CARRAY_SRC_CASE(ED, TD, UD, ND, ES, TS, US, NS) \
+                case ES: convert_##NS##_##ND(d, s, n, saturate); return true;
+#define CARRAY_DST_CASE(ED, TD, UD, ND) \
+        case ED: \
+            switch (srcType) { \
+                CARRAY_FOR_ALL_TYPES_2(CARRAY_SRC_CASE, ED, TD, UD, ND) \
+                default: break; \
+            } \
+            break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_DST_CASE)
+#undef  CARRAY_DST_CASE
+#undef  CARRAY_SRC_CASE
+        default: break;
+    }
+    return false;
+}
+
+/* ============================================================================================ */
+
+static bool isIntegerType(carray_type elementType)
+{
+    switch (elementType) {
+#define CARRAY_CASE(E, T, U, N) case E:
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Converts n elements from source type to destination type: each element is 
+ * multiplied by scale and offset is added using double arithmetic.
+ * If saturate is false, scaled values are converted to integer destination types
+ * via the largest integer type and then truncated to the destination bit width.
+ * Returns false for unknown element types.
+ */
+static bool convertElementsScaled(carray_type dstType, void* d, size_t dstSize, 
+                                  carray_type srcType, const void* s, size_t srcSize,
+                                  size_t n, double scale, double offset, bool saturate)
+{
+    double buffer[CARRAY_CONVERT_CHUNK];
+    MaxInt ibuffer[CARRAY_CONVERT_CHUNK];
+    bool   truncate = !saturate && isIntegerType(dstType);
+    while (n > 0) {
+        size_t m = (n < CARRAY_CONVERT_CHUNK) ? n : CARRAY_CONVERT_CHUNK;
+        switch (srcType) {
+#define CARRAY_CASE(E, T, U, N) case E: scale_##N(buffer, s, m, scale, offset); break;
+            CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: 
+                if (!convertElements(CARRAY_DOUBLE, buffer, srcType, s, m, true)) {
+                    return false;
+                }
+                scale_double(buffer, buffer, m, scale, offset);
+                break;
+        }
+        if (truncate) {
+            convertElements(CARRAY_MAXINT, ibuffer, CARRAY_DOUBLE, buffer, m, true);
+            if (!convertElements(dstType, d, CARRAY_MAXINT, ibuffer, m, false)) {
+                return false;
+            }
+        }
+        else if (!convertElements(dstType, d, CARRAY_DOUBLE, buffer, m, true)) {
+            return false;
+        }
+        d  = ((char*)d)       + m * dstSize;
+        s  = ((const char*)s) + m * srcSize;
+        n -= m;
+    }
+    return true;
+}
+
+/* ============================================================================================ */
+
 
 static int Carray_len(lua_State* L)
 {
@@ -509,33 +1147,163 @@ static int Carray_get(lua_State* L)
             while (--c >= 0) { lua_pushnumber(L, *(p++)); }
             break;
         }
-        default: return luaL_argerror(L, 1, "internal type error");
+        case CARRAY_HALF: {
+            unsigned short* p = (unsigned short*)ptr;
+            while (--c >= 0) { lua_pushnumber(L, halfToFloat(*(p++))); }
+            break;
+        }
+        case CARRAY_BFLOAT16: {
+            unsigned short* p = (unsigned short*)ptr;
+            while (--c >= 0) { lua_pushnumber(L, bfloat16ToFloat(*(p++))); }
+            break;
+        }
+        default: return luaL_argerror(L, 1, "unsupported element type");
     }
     return count > 0 ? (nilOffset + count) : nilOffset;
 }
 
-
 /* ============================================================================================ */
 
-static int Carray_set(lua_State* L)
+static int Carray_totable(lua_State* L)
 {
-    CarrayUserData* udata = checkWritableUdata(L, 1);
-    carray*         impl  = udata->impl;
-    
-    lua_Integer index = luaL_checkinteger(L, 2);
-    
-    size_t count = impl->elementCount;
-    if (index >= 0) {
-        index -= 1;
-    } else {
-        index = count + index;
+    carray* impl     = checkReadableUdata(L, 1)->impl;
+    int     tableArg = 2;
+    size_t  offset   = 0;
+    size_t  count    = impl->elementCount;
+    if (!lua_istable(L, tableArg)) {
+        checkRange(L, 2, impl->elementCount, &offset, &count);
+        tableArg = 4;
     }
-    if (index < 0 || index >= count) {
-        return luaL_argerror(L, 2, "index out of bounds");
+    size_t oldLen = 0;
+    if (lua_isnoneornil(L, tableArg)) {
+        lua_settop(L, tableArg - 1);
+        lua_createtable(L, (count < INT_MAX) ? (int)count : INT_MAX, 0);
+    } else {
+        luaL_checktype(L, tableArg, LUA_TTABLE);
+        oldLen = lua_rawlen(L, tableArg);
+        lua_settop(L, tableArg);
     }
-    char*   ptr         = impl->buffer;
-    int     topArg      = lua_gettop(L);
-
+    int         t   = lua_gettop(L);
+    const char* src = impl->buffer + offset * impl->elementSize;
+    
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: { const T* p = (const T*)src;              \
+                                          for (size_t i = 0; i < count; ++i) {     \
+                                              lua_pushinteger(L, p[i]);            \
+                                              lua_rawseti(L, t, i + 1);            \
+                                          } } break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: { const T* p = (const T*)src;              \
+                                          for (size_t i = 0; i < count; ++i) {     \
+                                              lua_pushnumber(L, p[i]);             \
+                                              lua_rawseti(L, t, i + 1);            \
+                                          } } break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: {
+            const unsigned short* p = (const unsigned short*)src;
+            bool isHalf = (impl->elementType == CARRAY_HALF);
+            for (size_t i = 0; i < count; ++i) {
+                lua_pushnumber(L, isHalf ? halfToFloat(p[i]) : bfloat16ToFloat(p[i]));
+                lua_rawseti(L, t, i + 1);
+            }
+            break;
+        }
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    for (size_t i = oldLen; i > count; --i) {
+        lua_pushnil(L);
+        lua_rawseti(L, t, i);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Module_fromtable(lua_State* L)
+{
+    carray_type type = checkElementType(L, 1);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    lua_Integer i = luaL_optinteger(L, 3, 1);
+    lua_Integer j = lua_isnoneornil(L, 4) ? (lua_Integer)lua_rawlen(L, 2) : luaL_checkinteger(L, 4);
+    size_t count  = (j >= i) ? (size_t)(j - i) + 1 : 0;
+    lua_settop(L, 2);
+
+    void*   data    = NULL;
+    carray* created = NULL;
+    if (type) {
+        created = carray_capi_impl.newCarray(L, type, CARRAY_DEFAULT, count, &data);
+    }
+    if (!created) {
+        return luaL_error(L, "cannot create carray for type '%s'", lua_tostring(L, 1));
+    }
+    size_t k = 0;
+    switch (type) {
+#define CARRAY_CASE(E, T, U, N) case E: { T* p = (T*)data;                                       \
+                                          for (; k < count; ++k) {                               \
+                                              lua_rawgeti(L, 2, i + k);                          \
+                                              if (!lua_isinteger(L, -1)) goto badValue;          \
+                                              p[k] = lua_tointeger(L, -1);                       \
+                                              lua_pop(L, 1);                                     \
+                                          } } break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: { T* p = (T*)data;                                       \
+                                          for (; k < count; ++k) {                               \
+                                              lua_rawgeti(L, 2, i + k);                          \
+                                              if (lua_type(L, -1) != LUA_TNUMBER) goto badValue; \
+                                              p[k] = lua_tonumber(L, -1);                        \
+                                              lua_pop(L, 1);                                     \
+                                          } } break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: {
+            unsigned short* p = (unsigned short*)data;
+            bool isHalf = (type == CARRAY_HALF);
+            for (; k < count; ++k) {
+                lua_rawgeti(L, 2, i + k);
+                if (lua_type(L, -1) != LUA_TNUMBER) goto badValue;
+                float v = (float)lua_tonumber(L, -1);
+                p[k] = isHalf ? floatToHalf(v) : floatToBfloat16(v);
+                lua_pop(L, 1);
+            }
+            break;
+        }
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+
+badValue:
+    return luaL_argerror(L, 2, lua_pushfstring(L, "%s expected at index %d", 
+                                               created->isInteger ? "integer" : "number", 
+                                               (int)(i + k)));
+}
+
+
+/* ============================================================================================ */
+
+static int Carray_set(lua_State* L)
+{
+    CarrayUserData* udata = checkWritableUdata(L, 1);
+    carray*         impl  = udata->impl;
+    
+    lua_Integer index = luaL_checkinteger(L, 2);
+    
+    size_t count = impl->elementCount;
+    if (index >= 0) {
+        index -= 1;
+    } else {
+        index = count + index;
+    }
+    if (index < 0 || index >= count) {
+        return luaL_argerror(L, 2, "index out of bounds");
+    }
+    char*   ptr         = impl->buffer;
+    int     topArg      = lua_gettop(L);
+
     int i = index;
     int a = 3;
 
@@ -615,7 +1383,19 @@ again:
                                                p[i++] = lua_tonumber(L, a++); }
             break;
         }
-        default: return luaL_argerror(L, 1, "internal type error");
+        case CARRAY_HALF: {
+            unsigned short* p = (unsigned short*)ptr;
+            while (i < count && a <= topArg) { if (lua_type(L, a) != LUA_TNUMBER) goto special;
+                                               p[i++] = floatToHalf((float)lua_tonumber(L, a++)); }
+            break;
+        }
+        case CARRAY_BFLOAT16: {
+            unsigned short* p = (unsigned short*)ptr;
+            while (i < count && a <= topArg) { if (lua_type(L, a) != LUA_TNUMBER) goto special;
+                                               p[i++] = floatToBfloat16((float)lua_tonumber(L, a++)); }
+            break;
+        }
+        default: return luaL_argerror(L, 1, "unsupported element type");
     }
     if (a <= topArg) {
         return luaL_argerror(L, a, "index out of bounds");
@@ -671,7 +1451,7 @@ special:;
         ++a;
         goto again;
     }
-    if (impl->elementType == CARRAY_FLOAT || impl->elementType == CARRAY_DOUBLE) {
+    if (!impl->isInteger) {
         return luaL_argerror(L, a, "number or carray expected");
     } else if (impl->elementType == CARRAY_UCHAR || impl->elementType == CARRAY_SCHAR) {
         return luaL_argerror(L, a, "integer, carray or string expected");
@@ -703,7 +1483,7 @@ static int internalInsert(lua_State* L, carray* impl, int insertPos, int firstAr
     int     arg         = firstArg;
     int     nargs       = lua_gettop(L) - arg + 1;
     size_t  pos0        = insertPos - 1;
-    void*   ptr0        = carray_capi_impl.insertElements(impl, pos0, nargs, calcGrowReservePercent(impl));
+    void*   ptr0        = carray_insert(impl, pos0, nargs, calcGrowReservePercent(impl));
     if (!ptr0) {
         return luaL_error(L, "adding elements failed");
     }
@@ -785,7 +1565,19 @@ again:
                                        *(p++) = lua_tonumber(L, arg++); }
             break;
         }
-        default: return luaL_argerror(L, 1, "internal type error");
+        case CARRAY_HALF: {
+            unsigned short* p = (unsigned short*)ptr0;
+            while (--remaining >= 0) { if (lua_type(L, arg) != LUA_TNUMBER) goto special; 
+                                       *(p++) = floatToHalf((float)lua_tonumber(L, arg++)); }
+            break;
+        }
+        case CARRAY_BFLOAT16: {
+            unsigned short* p = (unsigned short*)ptr0;
+            while (--remaining >= 0) { if (lua_type(L, arg) != LUA_TNUMBER) goto special; 
+                                       *(p++) = floatToBfloat16((float)lua_tonumber(L, arg++)); }
+            break;
+        }
+        default: return luaL_argerror(L, 1, "unsupported element type");
     }
     lua_settop(L, 1);
     return 1;
@@ -810,7 +1602,7 @@ special:
             if (otherInfo.elementType == impl->elementType) {
                 size_t otherCount = otherInfo.elementCount;
                 if (otherCount > 0) {
-                    ptr0 = carray_capi_impl.insertElements(impl, currPos, otherCount, calcGrowReservePercent(impl));
+                    ptr0 = carray_insert(impl, currPos, otherCount, calcGrowReservePercent(impl));
                     if (!ptr0) {
                         return luaL_error(L, "adding elements failed");
                     }
@@ -832,7 +1624,7 @@ special:
         size_t len = 0;
         const char* str = lua_tolstring(L, arg, &len);
         if (len > 0) {
-            ptr0 = carray_capi_impl.insertElements(impl, currPos, len, calcGrowReservePercent(impl));
+            ptr0 = carray_insert(impl, currPos, len, calcGrowReservePercent(impl));
             if (!ptr0) {
                 return luaL_error(L, "adding elements failed");
             }
@@ -848,7 +1640,7 @@ special:
         pos0 = currPos + addedCount;
         nargs = remaining;
         if (nargs > 0) {
-            ptr0 = carray_capi_impl.insertElements(impl, pos0, nargs, calcGrowReservePercent(impl));
+            ptr0 = carray_insert(impl, pos0, nargs, calcGrowReservePercent(impl));
             if (!ptr0) {
                 return luaL_error(L, "adding elements failed");
             }
@@ -858,7 +1650,7 @@ special:
             return 1;
         }
     }
-    if (impl->elementType == CARRAY_FLOAT || impl->elementType == CARRAY_DOUBLE) {
+    if (!impl->isInteger) {
         return luaL_argerror(L, arg, "number or carray expected");
     } else if (impl->elementType == CARRAY_UCHAR || impl->elementType == CARRAY_SCHAR) {
         return luaL_argerror(L, arg, "integer, carray or string expected");
@@ -897,6 +1689,189 @@ static int Carray_insert(lua_State* L)
 
 /* ============================================================================================ */
 
+static const char* const byteOrderNames[] = { "native", "little", "big", NULL };
+
+/**
+ * Returns true if the byte order given at stack index arg differs from the
+ * native byte order.
+ */
+static bool checkByteSwap(lua_State* L, int arg)
+{
+    const unsigned short one = 1;
+    bool isLittle = (*(const unsigned char*)&one == 1);
+    int  order    = luaL_checkoption(L, arg, "native", byteOrderNames);
+    return order != 0 && (order == 1) != isLittle;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Copies count elements from src to dest and reverses the byte order of 
+ * each element if swap is true. src and dest may be the same.
+ */
+static void CARRAY_VECTORIZE copyBytes(char* dest, const char* src, size_t count, size_t elementSize, bool swap)
+{
+    if (!swap || elementSize == 1) {
+        memmove(dest, src, count * elementSize);
+        return;
+    }
+#if defined(__GNUC__)
+    switch (elementSize) {
+        case 2: for (size_t i = 0; i < count; ++i) {
+                    unsigned short v; memcpy(&v, src + 2 * i, 2);
+                    v = __builtin_bswap16(v); memcpy(dest + 2 * i, &v, 2);
+                }
+                return;
+        case 4: for (size_t i = 0; i < count; ++i) {
+                    unsigned int v; memcpy(&v, src + 4 * i, 4);
+                    v = __builtin_bswap32(v); memcpy(dest + 4 * i, &v, 4);
+                }
+                return;
+        case 8: for (size_t i = 0; i < count; ++i) {
+                    MaxUInt v; memcpy(&v, src + 8 * i, 8);
+                    v = __builtin_bswap64(v); memcpy(dest + 8 * i, &v, 8);
+                }
+                return;
+    }
+#endif
+    memmove(dest, src, count * elementSize);
+    for (size_t i = 0; i < count; ++i) {
+        char* p = dest + i * elementSize;
+        for (size_t j = 0, k = elementSize - 1; j < k; ++j, --k) {
+            char t = p[j]; p[j] = p[k]; p[k] = t;
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+static const char* checkBytes(lua_State* L, int arg, carray* impl, size_t* count)
+{
+    size_t      len;
+    const char* str = luaL_checklstring(L, arg, &len);
+    if (len % impl->elementSize != 0) {
+        luaL_argerror(L, arg, "string length is not a multiple of the element size");
+    }
+    *count = len / impl->elementSize;
+    return str;
+}
+
+/* ============================================================================================ */
+
+static int Carray_tobytes(lua_State* L)
+{
+    carray* impl     = checkReadableUdata(L, 1)->impl;
+    int     orderArg = 2;
+    size_t  offset   = 0;
+    size_t  count    = impl->elementCount;
+    if (lua_type(L, orderArg) != LUA_TSTRING) {
+        checkRange(L, 2, impl->elementCount, &offset, &count);
+        orderArg = 4;
+    }
+    bool        swap = checkByteSwap(L, orderArg);
+    size_t      len  = count * impl->elementSize;
+    const char* src  = impl->buffer + offset * impl->elementSize;
+    if (len == 0) {
+        lua_pushstring(L, "");
+    } else if (!swap || impl->elementSize == 1) {
+        lua_pushlstring(L, src, len);
+    } else {
+        luaL_Buffer b;
+        char* dest = luaL_buffinitsize(L, &b, len);
+        copyBytes(dest, src, count, impl->elementSize, true);
+        luaL_pushresultsize(&b, len);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_appendbytes(lua_State* L)
+{
+    carray*     impl = checkWritableUdata(L, 1)->impl;
+    size_t      count;
+    const char* str  = checkBytes(L, 2, impl, &count);
+    bool        swap = checkByteSwap(L, 3);
+    if (count > 0) {
+        char* dest = carray_insert(impl, impl->elementCount, count, calcGrowReservePercent(impl));
+        if (!dest) {
+            return luaL_error(L, "adding elements failed");
+        }
+        copyBytes(dest, str, count, impl->elementSize, swap);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_setbytes(lua_State* L)
+{
+    carray*     impl  = checkWritableUdata(L, 1)->impl;
+    lua_Integer index = luaL_checkinteger(L, 2);
+    size_t      count;
+    const char* str   = checkBytes(L, 3, impl, &count);
+    bool        swap  = checkByteSwap(L, 4);
+
+    size_t totalCount = impl->elementCount;
+    if (index >= 0) {
+        index -= 1;
+    } else {
+        index = totalCount + index;
+    }
+    if (index < 0 || (size_t)index >= totalCount) {
+        return luaL_argerror(L, 2, "index out of bounds");
+    }
+    if (count > totalCount - (size_t)index) {
+        return luaL_argerror(L, 3, "string exceeds array length");
+    }
+    copyBytes(impl->buffer + index * impl->elementSize, str, count, impl->elementSize, swap);
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Returns true if the n1 bytes at p1 and the n2 bytes at p2 overlap. Different arrays 
+ * may share memory, e.g. an array and its views.
+ */
+static bool overlaps(const void* p1, size_t n1, const void* p2, size_t n2)
+{
+    return n1 > 0 && n2 > 0 && (const char*)p1 < (const char*)p2 + n2 
+                            && (const char*)p2 < (const char*)p1 + n1;
+}
+
+/**
+ * Returns the n bytes at src or, if they overlap the buffer of the destination array 
+ * dst, a copy that is pushed onto the stack, because writing the destination would 
+ * overwrite source elements before they are read.
+ */
+static const void* separateSource(lua_State* L, const void* src, size_t n, const carray* dst)
+{
+    if (overlaps(dst->buffer, dst->elementCapacity * dst->elementSize, src, n)) {
+        void* tmp = lua_newuserdata(L, n);
+        memcpy(tmp, src, n);
+        return tmp;
+    }
+    return src;
+}
+
+/**
+ * Copies count elements from src of array impl2 to dest of array impl1. The elements
+ * are converted with saturation if the arrays have different element types.
+ */
+static void copyElements(carray* impl1, void* dest, const carray* impl2, const void* src, size_t count)
+{
+    if (impl1->elementType == impl2->elementType) {
+        memcpy(dest, src, count * impl1->elementSize);
+    } else {
+        convertElements(impl1->elementType, dest, impl2->elementType, src, count, true);
+    }
+}
+
+/* ============================================================================================ */
+
 static int Carray_appendsub(lua_State* L)
 {
     int arg = 1;
@@ -912,9 +1887,6 @@ static int Carray_appendsub(lua_State* L)
     }
     else {
         impl2 = checkReadableUdata(L, arg)->impl;
-        if (impl2->elementType != impl1->elementType) {
-            return luaL_argerror(L, arg, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl1)));
-        }
         otherCount = impl2->elementCount;
     }
     ++arg;
@@ -935,17 +1907,16 @@ static int Carray_appendsub(lua_State* L)
     }
     lua_Integer count = index2 - index1 + 1;
     if (count > 0) {
-        void* dest = carray_capi_impl.insertElements(impl1, impl1->elementCount, count, calcGrowReservePercent(impl1));
+        void* dest = carray_insert(impl1, impl1->elementCount, count, calcGrowReservePercent(impl1));
         if (!dest) {
             return luaL_error(L, "insert into carray failed");
         }
-        const void* src;
         if (str) {
-            src = str + index1 - 1;
+            memcpy(dest, str + index1 - 1, count);
         } else {
-            src = carray_capi_impl.getReadableElementPtr(impl2, index1 - 1, count);
+            const void* src = carray_capi_impl.getReadableElementPtr(impl2, index1 - 1, count);
+            copyElements(impl1, dest, impl2, src, count);
         }
-        memcpy(dest, src, count * impl1->elementSize);
     }
     lua_settop(L, 1);
     return 1;
@@ -974,9 +1945,6 @@ static int Carray_insertsub(lua_State* L)
     }
     else {
         impl2 = checkReadableUdata(L, arg)->impl;
-        if (impl2->elementType != impl1->elementType) {
-            return luaL_argerror(L, arg, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl1)));
-        }
         otherCount = impl2->elementCount;
     }
     ++arg;
@@ -998,7 +1966,7 @@ static int Carray_insertsub(lua_State* L)
     lua_Integer fromPos = index1;
     lua_Integer count   = index2 - index1 + 1;
     if (count > 0) {
-        char* dest = carray_capi_impl.insertElements(impl1, insertPos - 1, count, calcGrowReservePercent(impl1));
+        char* dest = carray_insert(impl1, insertPos - 1, count, calcGrowReservePercent(impl1));
         if (!dest) {
             return luaL_error(L, "insert into carray failed");
         }
@@ -1008,7 +1976,7 @@ static int Carray_insertsub(lua_State* L)
         else {
             if (impl1 != impl2) {
                 const void* src = carray_capi_impl.getReadableElementPtr(impl2, fromPos - 1, count);
-                memcpy(dest, src, count * impl1->elementSize);
+                copyElements(impl1, dest, impl2, src, count);
             } else {
                 if (fromPos < insertPos) {
                     lua_Integer c = insertPos - fromPos;
@@ -1056,9 +2024,6 @@ static int Carray_setsub(lua_State* L)
     }
     else {
         impl2 = checkReadableUdata(L, arg)->impl;
-        if (impl2->elementType != impl1->elementType) {
-            return luaL_argerror(L, arg, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl1)));
-        }
         otherCount = impl2->elementCount;
     }
     ++arg;
@@ -1083,20 +2048,251 @@ static int Carray_setsub(lua_State* L)
         return luaL_argerror(L, 1, "insufficient array length");
     }
     if (count > 0) {
-        void* dest = carray_capi_impl.getWritableElementPtr(impl1, insertPos - 1, count);
-        if (!dest) {
-            return luaL_error(L, "set into carray failed");
-        }
+        void* dest = impl1->buffer + (insertPos - 1) * impl1->elementSize;
         if (str) {
             memcpy(dest, str + fromPos - 1, count);
         } 
         else {
             const void* src = carray_capi_impl.getReadableElementPtr(impl2, fromPos - 1, count);
-            if (impl1 != impl2) {
-                memcpy(dest, src, count * impl1->elementSize);
-            } else {
+            if (impl1->elementType == impl2->elementType) {
                 memmove(dest, src, count * impl1->elementSize);
+            } else {
+                src = separateSource(L, src, count * impl2->elementSize, impl1);
+                copyElements(impl1, dest, impl2, src, count);
+            }
+        }
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+#define CARRAY_FILL(E, T, U, N) \
+    static CARRAY_VECTORIZE void fill_##N(T* d, T v, size_t n) \
+    { \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            d[i] = v; \
+        } \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_FILL)
+
+/**
+ * Sets count elements at dest to the element value at ptr. Values consisting of
+ * identical bytes (e.g. zero) are set using memset.
+ */
+static bool fillElements(carray_type elementType, void* dest, size_t elementSize, const void* ptr, size_t count)
+{
+    const unsigned char* bytes = ptr;
+    size_t i;
+    for (i = 1; i < elementSize && bytes[i] == bytes[0]; ++i);
+    if (i == elementSize) {
+        memset(dest, bytes[0], count * elementSize);
+        return true;
+    }
+    switch (elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: { T v; memcpy(&v, ptr, sizeof(v)); fill_##N(dest, v, count); } return true;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: { unsigned short v; memcpy(&v, ptr, sizeof(v)); fill_ushort(dest, v, count); } return true;
+        default: return false;
+    }
+}
+
+/**
+ * Repeats the pattern of patternCount elements at src over count elements at dest. 
+ * The pattern is copied once and then the already filled part is copied with doubling 
+ * size. src may overlap dest if both arrays have the same element type.
+ */
+static void fillPattern(carray* impl1, char* dest, const carray* impl2, const void* src, size_t patternCount, size_t count)
+{
+    size_t elementSize = impl1->elementSize;
+    size_t filled      = (patternCount < count) ? patternCount : count;
+    if (!impl2) {
+        memcpy(dest, src, filled);
+    } else if (impl1->elementType == impl2->elementType) {
+        memmove(dest, src, filled * elementSize);
+    } else {
+        copyElements(impl1, dest, impl2, src, filled);
+    }
+    while (filled < count) {
+        size_t n = (filled < count - filled) ? filled : count - filled;
+        memcpy(dest + filled * elementSize, dest, n * elementSize);
+        filled += n;
+    }
+}
+
+static int Carray_fill(lua_State* L)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    
+    size_t      patternCount = 0;
+    const void* pattern      = NULL;
+    carray*     impl2        = NULL;
+    unsigned char value[sizeof(MaxInt) > sizeof(double) ? sizeof(MaxInt) : sizeof(double)];
+
+    if ((impl->elementType == CARRAY_UCHAR || impl->elementType == CARRAY_SCHAR) && lua_type(L, 2) == LUA_TSTRING)
+    {
+        pattern = lua_tolstring(L, 2, &patternCount);
+    }
+    else if (luaL_testudata(L, 2, CARRAY_CLASS_NAME)) {
+        impl2        = checkReadableUdata(L, 2)->impl;
+        pattern      = impl2->buffer;
+        patternCount = impl2->elementCount;
+    }
+    else if (impl->isInteger) {
+        if (!lua_isinteger(L, 2)) {
+            if (impl->elementType == CARRAY_UCHAR || impl->elementType == CARRAY_SCHAR) {
+                return luaL_argerror(L, 2, "integer, carray or string expected");
+            } else {
+                return luaL_argerror(L, 2, "integer or carray expected");
+            }
+        }
+        lua_Integer v = lua_tointeger(L, 2);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: { T t = (T)v; memcpy(value, &t, sizeof(t)); } break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    else {
+        if (lua_type(L, 2) != LUA_TNUMBER) {
+            return luaL_argerror(L, 2, "number or carray expected");
+        }
+        lua_Number v = lua_tonumber(L, 2);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: { T t = (T)v; memcpy(value, &t, sizeof(t)); } break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            case CARRAY_HALF:     { unsigned short t = floatToHalf((float)v);     memcpy(value, &t, sizeof(t)); } break;
+            case CARRAY_BFLOAT16: { unsigned short t = floatToBfloat16((float)v); memcpy(value, &t, sizeof(t)); } break;
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    if (pattern && patternCount == 0) {
+        return luaL_argerror(L, 2, "empty pattern");
+    }
+    if (count > 0) {
+        char* dest = impl->buffer + offset * impl->elementSize;
+        if (pattern) {
+            if (impl2 && impl2->elementType != impl->elementType) {
+                size_t n = (patternCount < count) ? patternCount : count;
+                pattern  = separateSource(L, pattern, n * impl2->elementSize, impl);
             }
+            fillPattern(impl, dest, impl2, pattern, patternCount, count);
+        } 
+        else if (!fillElements(impl->elementType, dest, impl->elementSize, value, count)) {
+            return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_zero(lua_State* L)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    if (count > 0) {
+        memset(impl->buffer + offset * impl->elementSize, 0, count * impl->elementSize);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/* rotations moving at most this number of bytes are done with a stack buffer */
+#define CARRAY_ROTATE_BUFFER 512
+
+#define CARRAY_REVERSE(E, T, U, N) \
+    static CARRAY_VECTORIZE void reverse_##N(T* a, size_t n) \
+    { \
+        size_t i; \
+        T*     b = a + n - 1; \
+        for (i = 0; i < n / 2; ++i) { \
+            T t  = a[i]; \
+            a[i] = b[-(ptrdiff_t)i]; \
+            b[-(ptrdiff_t)i] = t; \
+        } \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_REVERSE)
+
+static void internalReverse(lua_State* L, carray* impl, char* ptr, size_t count)
+{
+    if (count < 2) {
+        return;
+    }
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: reverse_##N((T*)ptr, count); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: reverse_ushort((unsigned short*)ptr, count); break;
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+/**
+ * Moves the first k of count elements at ptr to the end, 0 < k < count. Short parts 
+ * are moved through a stack buffer, otherwise three reversals are used.
+ */
+static void internalRotateLeft(lua_State* L, carray* impl, char* ptr, size_t count, size_t k)
+{
+    size_t es = impl->elementSize;
+    char   tmp[CARRAY_ROTATE_BUFFER];
+    if (k * es <= CARRAY_ROTATE_BUFFER) {
+        memcpy(tmp, ptr, k * es);
+        memmove(ptr, ptr + k * es, (count - k) * es);
+        memcpy(ptr + (count - k) * es, tmp, k * es);
+    }
+    else if ((count - k) * es <= CARRAY_ROTATE_BUFFER) {
+        memcpy(tmp, ptr + k * es, (count - k) * es);
+        memmove(ptr + (count - k) * es, ptr, k * es);
+        memcpy(ptr, tmp, (count - k) * es);
+    }
+    else {
+        internalReverse(L, impl, ptr, k);
+        internalReverse(L, impl, ptr + k * es, count - k);
+        internalReverse(L, impl, ptr, count);
+    }
+}
+
+/* ============================================================================================ */
+
+static int Carray_reverse(lua_State* L)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    internalReverse(L, impl, impl->buffer + offset * impl->elementSize, count);
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_rotate(lua_State* L)
+{
+    carray*     impl = checkWritableUdata(L, 1)->impl;
+    lua_Integer k    = luaL_checkinteger(L, 2);
+    size_t      offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    if (count > 1) {
+        /* positive k moves the elements towards the end, i.e. rotate left by count - k */
+        size_t r = (k >= 0) ? (size_t)k % count : count - (size_t)(-(k + 1)) % count - 1;
+        if (r > 0) {
+            internalRotateLeft(L, impl, impl->buffer + offset * impl->elementSize, count, count - r);
         }
     }
     lua_settop(L, 1);
@@ -1174,9 +2370,9 @@ static int Carray_setlen(lua_State* L)
     }
 
     if (newCount <= oldCount && !shrink) {
-        impl->elementCount = newCount;
+        carray_set_count(impl, newCount);
     } else {
-        if (!carray_capi_impl.resizeCarray(impl, newCount, shrink ? -1 : 0)) {
+        if (!carray_resize(impl, newCount, shrink ? -1 : 0)) {
             return luaL_error(L, "resizing carray failed");
         }
     }
@@ -1202,11 +2398,10 @@ static int Carray_reserve(lua_State* L)
         size_t      currCount = impl->elementCount;
         size_t      currRes   = impl->elementCapacity - currCount;
         if (newRes > 0 && newRes > currRes) {
-            carray_capi_impl.resizeCarray(impl, currCount + newRes, 0);
-            impl->elementCount = currCount;
+            carray_reserve(impl, currCount + newRes);
         }
         else if (newRes <= 0) {
-            carray_capi_impl.resizeCarray(impl, currCount, -1);
+            carray_resize(impl, currCount, -1);
         }
         lua_settop(L, 1);
         return 1;
@@ -1226,9 +2421,9 @@ static int Carray_reset(lua_State* L)
         shrink = lua_toboolean(L, 2);
     }
     if (!shrink) {
-        udata->impl->elementCount = 0;
+        carray_set_count(udata->impl, 0);
     } else {
-        carray_capi_impl.resizeCarray(udata->impl, 0, -1);
+        carray_resize(udata->impl, 0, -1);
     }
     lua_settop(L, 1);
     return 1;
@@ -1272,60 +2467,180 @@ static int Carray_writable(lua_State* L)
 
 /* ============================================================================================ */
 
-static int Carray_resizable(lua_State* L)
+static int Carray_view(lua_State* L)
 {
-    CarrayUserData* udata = luaL_checkudata(L, 1, CARRAY_CLASS_NAME);
-    lua_pushboolean(L, udata->impl && !(udata->impl->attr & CARRAY_READONLY) && !udata->impl->isRef);
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    if (!carray_new_view(L, impl, offset, count)) {
+        return luaL_error(L, "cannot create carray");
+    }
     return 1;
 }
 
 /* ============================================================================================ */
 
-static int Carray_appendfile(lua_State* L)
+static int Carray_shape(lua_State* L)
 {
-    int arg = 1;
-    CarrayUserData* udata = checkWritableUdata(L, arg);
-    carray*         impl  = udata->impl;
-    
-    int t = lua_type(L, ++arg);
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    size_t  ndims = impl->ndims;
+    if (ndims == 0) {
+        lua_pushinteger(L, impl->elementCount);
+        return 1;
+    }
+    luaL_checkstack(L, ndims, NULL);
+    for (size_t i = 0; i < ndims; ++i) {
+        lua_pushinteger(L, impl->dims[i]);
+    }
+    return ndims;
+}
 
-    luaL_Stream* stream = NULL;
-    const char*  fname  = NULL;
-    int          fd     = -1;
+/* ============================================================================================ */
 
-    if (t == LUA_TUSERDATA) {
-        stream = (luaL_Stream*)luaL_testudata(L, arg, LUA_FILEHANDLE);
+static int Carray_reshape(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  dims[CARRAY_MAX_DIMS];
+    size_t  total;
+    size_t  ndims = 0;
+    if (lua_gettop(L) > 1) {
+        ndims = checkShape(L, 2, &impl->elementCount, dims, &total);
+        if (total != impl->elementCount) {
+            return luaL_argerror(L, 2, "shape does not match array length");
+        }
     }
-    else if (t == LUA_TSTRING) {
+    if (!carray_set_shape(impl, dims, ndims)) {
+        return luaL_error(L, "cannot allocate carray");
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_slice(lua_State* L)
+{
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    size_t  ndims = impl->ndims;
+    size_t  rows  = (ndims > 0) ? impl->dims[0] : impl->elementCount;
+    size_t  offset, count;
+    checkRange(L, 2, rows, &offset, &count);
+
+    size_t rowSize = (rows > 0) ? impl->elementCount / rows : 0;
+    carray* view = carray_new_view(L, impl, offset * rowSize, count * rowSize);
+    if (!view) {
+        return luaL_error(L, "cannot create carray");
+    }
+    if (ndims > 0) {
+        size_t dims[CARRAY_MAX_DIMS];
+        memcpy(dims, impl->dims, ndims * sizeof(size_t));
+        dims[0] = count;
+        if (!carray_set_shape(view, dims, ndims)) {
+            return luaL_error(L, "cannot allocate carray");
+        }
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_clone(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    if (!carray_new_clone(L, impl)) {
+        return luaL_error(L, "cannot create carray");
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_ptr(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    if (!(impl->attr & CARRAY_READONLY)) {
+        if (!carray_unshare(impl)) {
+            return luaL_error(L, "cannot allocate carray");
+        }
+        carray_mark_exported(impl);
+    }
+    lua_pushlightuserdata(L, impl->buffer);
+    lua_pushinteger(L, impl->elementCount);
+    return 2;
+}
+
+/* ============================================================================================ */
+
+static int Carray_resizable(lua_State* L)
+{
+    CarrayUserData* udata = luaL_checkudata(L, 1, CARRAY_CLASS_NAME);
+    lua_pushboolean(L, udata->impl && carray_is_resizable(udata->impl));
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Checks for an open Lua file handle, a file name or a file descriptor at stack
+ * index arg. Returns the file handle or the opened file, otherwise NULL and the
+ * file descriptor in *fd. *stream is set if arg is a Lua file handle.
+ */
+static FILE* checkFileArg(lua_State* L, int arg, const char* mode, luaL_Stream** stream, int* fd)
+{
+    int t = lua_type(L, arg);
+
+    const char*  fname  = NULL;
+    *stream = NULL;
+    *fd     = -1;
+
+    if (t == LUA_TUSERDATA) {
+        *stream = (luaL_Stream*)luaL_testudata(L, arg, LUA_FILEHANDLE);
+    }
+    else if (t == LUA_TSTRING) {
         fname = lua_tostring(L, arg);
     }
     else if (t == LUA_TNUMBER) {
         int isnum = 0;
         lua_Integer i = lua_tointegerx(L, arg, &isnum);
         if (isnum) {
-            fd = i;
+            *fd = i;
         }
     }
     FILE* file = NULL;
-    if (stream) {
-        file = stream->f;
+    if (*stream) {
+        file = (*stream)->f;
         if (!file 
 #if LUA_VERSION_NUM >= 502
-           || !stream->closef
+           || !(*stream)->closef
 #endif
         ) {
-            return luaL_argerror(L, arg, "invalid file");
+            luaL_argerror(L, arg, "invalid file");
         }
     }
     else if (fname) {
-        file = fopen(fname, "rb");
+        file = fopen(fname, mode);
         if (!file) {
-            return luaL_argerror(L, arg, lua_pushfstring(L, "cannot open file: %s", fname));
+            luaL_argerror(L, arg, lua_pushfstring(L, "cannot open file: %s", fname));
         }
     }
-    else if (fd < 0) {
-        return luaL_argerror(L, arg, "file handle or name expected");
+    else if (*fd < 0) {
+        luaL_argerror(L, arg, "file handle or name expected");
     }
+    return file;
+}
+
+/* ============================================================================================ */
+
+static int Carray_appendfile(lua_State* L)
+{
+    int arg = 1;
+    CarrayUserData* udata = checkWritableUdata(L, arg);
+    carray*         impl  = udata->impl;
+    
+    luaL_Stream* stream;
+    int          fd;
+    FILE*        file = checkFileArg(L, ++arg, "rb", &stream, &fd);
+
     lua_Integer maxCount = -1;
     if (!lua_isnoneornil(L, ++arg)) {
         maxCount = luaL_checkinteger(L, arg);
@@ -1352,7 +2667,7 @@ again:;
             nitems = 8*1024;
         }
     }
-    char* data = carray_capi_impl.resizeCarray(impl, elementCount + nitems, 0);
+    char* data = carray_reserve(impl, elementCount + nitems) ? impl->buffer : NULL;
     if (!data) {
         if (file && !stream) fclose(file);
         return luaL_error(L, "resizing carray failed");
@@ -1372,12 +2687,10 @@ again:;
     }
     if (rslt > 0) {
         totalCount += rslt;
-        impl->elementCount = elementCount + rslt;
+        carray_set_count(impl, elementCount + rslt);
         if (rslt == nitems && maxCount < 0) {
             goto again;
         }
-    } else {
-        impl->elementCount = elementCount; // reset resizeCarray
     }
     if (rslt < nitems) {
         if (file) {
@@ -1398,6 +2711,283 @@ again:;
 
 /* ============================================================================================ */
 
+#if defined(WIN32) || defined(_WIN32)
+    typedef SSIZE_T CarraySsize;
+#else
+    typedef ssize_t CarraySsize;
+#endif
+
+/* maximal number of bytes for one write call */
+#define CARRAY_WRITE_CHUNK ((size_t)1 << 30)
+
+/**
+ * Writes len bytes to the file descriptor, partial writes are continued.
+ * Returns false on error, errno is set.
+ */
+static bool writeAll(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        size_t      n    = (len < CARRAY_WRITE_CHUNK) ? len : CARRAY_WRITE_CHUNK;
+        CarraySsize rslt = write(fd, data, n);
+        if (rslt < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += rslt;
+        len  -= rslt;
+    }
+    return true;
+}
+
+/* ============================================================================================ */
+
+static int syncFile(int fd)
+{
+#if defined(__linux__)
+    return fdatasync(fd);
+#elif defined(__unix__) || defined(__unix) || (defined (__APPLE__) && defined (__MACH__))
+    return fsync(fd);
+#else
+    (void)fd;
+    return 0;
+#endif
+}
+
+/* ============================================================================================ */
+
+static int Carray_writefile(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+
+    size_t offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    bool sync = false;
+    if (!lua_isnoneornil(L, 5)) {
+        luaL_checktype(L, 5, LUA_TBOOLEAN);
+        sync = lua_toboolean(L, 5);
+    }
+    luaL_Stream* stream;
+    int          fd;
+    FILE*        file = checkFileArg(L, 2, "wb", &stream, &fd);
+
+    const char* data = impl->buffer + offset * impl->elementSize;
+    size_t      len  = count * impl->elementSize;
+    bool        ok;
+    if (file) {
+        ok = (len == 0 || fwrite(data, 1, len, file) == len) && fflush(file) == 0;
+        if (ok && sync) {
+            ok = syncFile(fileno(file)) == 0;
+        }
+    } else {
+        ok = writeAll(fd, data, len) && (!sync || syncFile(fd) == 0);
+    }
+    int en = errno;
+    if (file && !stream && fclose(file) != 0 && ok) {
+        ok = false;
+        en = errno;
+    }
+    if (!ok) {
+        return luaL_error(L, "error writing to file: %s (errno=%d)", strerror(en), en);
+    }
+    lua_pushinteger(L, count);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+#if !defined(WIN32) && !defined(_WIN32)
+  #if defined(IOV_MAX) && IOV_MAX < 64
+    #define CARRAY_IOV_MAX IOV_MAX
+  #else
+    #define CARRAY_IOV_MAX 64
+  #endif
+#endif
+
+static int Module_writev(lua_State* L)
+{
+    int fd = -1;
+    luaL_Stream* stream = (luaL_Stream*)luaL_testudata(L, 1, LUA_FILEHANDLE);
+    if (stream) {
+        if (!stream->f 
+#if LUA_VERSION_NUM >= 502
+           || !stream->closef
+#endif
+        ) {
+            return luaL_argerror(L, 1, "invalid file");
+        }
+        fflush(stream->f);
+        fd = fileno(stream->f);
+    } else {
+        int isnum = 0;
+        lua_Integer i = lua_tointegerx(L, 1, &isnum);
+        if (!isnum || i < 0) {
+            return luaL_argerror(L, 1, "file handle or descriptor expected");
+        }
+        fd = i;
+    }
+    int nargs = lua_gettop(L);
+    for (int arg = 2; arg <= nargs; ++arg) {
+        checkReadableUdata(L, arg);
+    }
+    lua_Integer total = 0;
+    int         arg   = 2;
+    while (arg <= nargs) {
+#if defined(WIN32) || defined(_WIN32)
+        carray* impl = checkReadableUdata(L, arg++)->impl;
+        size_t  len  = impl->elementCount * impl->elementSize;
+        if (!writeAll(fd, impl->buffer, len)) {
+            int en = errno;
+            return luaL_error(L, "error writing to file: %s (errno=%d)", strerror(en), en);
+        }
+        total += len;
+#else
+        struct iovec  iovs[CARRAY_IOV_MAX];
+        struct iovec* iov    = iovs;
+        int           iovcnt = 0;
+        while (arg <= nargs && iovcnt < CARRAY_IOV_MAX) {
+            carray* impl = checkReadableUdata(L, arg++)->impl;
+            size_t  len  = impl->elementCount * impl->elementSize;
+            if (len > 0) {
+                iovs[iovcnt].iov_base = impl->buffer;
+                iovs[iovcnt].iov_len  = len;
+                iovcnt += 1;
+            }
+        }
+        while (iovcnt > 0) {
+            CarraySsize n = writev(fd, iov, iovcnt);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int en = errno;
+                return luaL_error(L, "error writing to file: %s (errno=%d)", strerror(en), en);
+            }
+            total += n;
+            while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+                n -= iov->iov_len;
+                iov    += 1;
+                iovcnt -= 1;
+            }
+            if (iovcnt > 0) {
+                iov->iov_base  = (char*)iov->iov_base + n;
+                iov->iov_len  -= n;
+            }
+        }
+#endif
+    }
+    lua_pushinteger(L, total);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+#if !defined(WIN32) && !defined(_WIN32)
+
+/**
+ * Unmaps len bytes starting at data. The mapping starts at the beginning
+ * of the page containing data.
+ */
+static void unmapElements(void* data, size_t len)
+{
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t delta    = (size_t)data % pageSize;
+    munmap((char*)data - delta, len + delta);
+}
+
+#define CARRAY_UNMAP_CALLBACK(S) \
+    static void unmapElements##S(void* dataRef, size_t elementCount) { unmapElements(dataRef, elementCount * S); }
+
+CARRAY_UNMAP_CALLBACK(1)
+CARRAY_UNMAP_CALLBACK(2)
+CARRAY_UNMAP_CALLBACK(4)
+CARRAY_UNMAP_CALLBACK(8)
+
+#undef CARRAY_UNMAP_CALLBACK
+
+#endif
+
+/* ============================================================================================ */
+
+static const char* const mmapModeNames[] = { "r", "w", NULL };
+
+static int Module_mmap(lua_State* L)
+{
+    const char* fname       = luaL_checkstring(L, 1);
+    carray_type type        = checkElementType(L, 2);
+    bool        writable    = luaL_checkoption(L, 3, "r", mmapModeNames) == 1;
+    lua_Integer offset      = luaL_optinteger(L, 4, 0);
+    size_t      elementSize = type ? elementTypeSize(type) : 0;
+
+    if (elementSize == 0) {
+        return luaL_error(L, "cannot create carray for type '%s'", lua_tostring(L, 2));
+    }
+    if (offset < 0 || offset % elementSize != 0) {
+        return luaL_argerror(L, 4, "offset must be a non-negative multiple of the element size");
+    }
+#if !defined(WIN32) && !defined(_WIN32)
+    void (*releaseCallback)(void*, size_t) = NULL;
+    switch (elementSize) {
+        case 1: releaseCallback = unmapElements1; break;
+        case 2: releaseCallback = unmapElements2; break;
+        case 4: releaseCallback = unmapElements4; break;
+        case 8: releaseCallback = unmapElements8; break;
+        default: return luaL_argerror(L, 2, "unsupported element type");
+    }
+    int fd = open(fname, writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+        return luaL_argerror(L, 1, lua_pushfstring(L, "cannot open file: %s", fname));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int en = errno;
+        close(fd);
+        return luaL_error(L, "cannot access file: %s (errno=%d)", strerror(en), en);
+    }
+    lua_Integer fileSize = st.st_size;
+    lua_Integer count;
+    if (lua_isnoneornil(L, 5)) {
+        count = (offset < fileSize) ? (fileSize - offset) / (lua_Integer)elementSize : 0;
+    } else {
+        count = luaL_checkinteger(L, 5);
+        if (count < 0 || count > (fileSize - offset) / (lua_Integer)elementSize) {
+            close(fd);
+            return luaL_argerror(L, 5, "range exceeds file size");
+        }
+    }
+    if ((size_t)count > SIZE_MAX / elementSize) {
+        close(fd);
+        return luaL_argerror(L, 5, "range too large");
+    }
+    carray_attr attr = writable ? CARRAY_DEFAULT : CARRAY_READONLY;
+    if (count == 0) {
+        close(fd);
+        carray_capi_impl.newCarray(L, type, attr, 0, NULL);
+        return 1;
+    }
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t delta    = (size_t)(offset % pageSize);
+    size_t len      = count * elementSize + delta;
+    char*  data     = mmap(NULL, len, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, 
+                           MAP_SHARED, fd, offset - delta);
+    int en = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+        return luaL_error(L, "cannot map file: %s (errno=%d)", strerror(en), en);
+    }
+    if (!carray_capi_impl.newCarrayRef(L, type, attr, data + delta, count, releaseCallback)) {
+        munmap(data, len);
+        return luaL_error(L, "cannot create carray");
+    }
+    return 1;
+#else
+    return luaL_error(L, "carray.mmap is not supported on this platform");
+#endif
+}
+
+/* ============================================================================================ */
+
 static int Carray_equals(lua_State* L)
 {
     carray* udata1 = checkReadableUdata(L, 1)->impl;
@@ -1414,6 +3004,2464 @@ static int Carray_equals(lua_State* L)
 
 /* ============================================================================================ */
 
+/* number of elements that are summed up sequentially in pairwise summation */
+#define CARRAY_PAIRWISE_BLOCK 128
+
+/* number of elements that are compared without branches when scanning for a value */
+#define CARRAY_SCAN_BLOCK 32
+
+/**
+ * dsum:     sum of the elements as double using pairwise summation for accuracy.
+ * minmax:   minimum and maximum element, NaN values are ignored, n must be > 0.
+ * indexof:  index of the first element that equals v or n if not found.
+ * rindexof: index + 1 of the last element that equals v or 0 if not found.
+ * countof:  number of elements that are equal to v.
+ */
+#define CARRAY_REDUCE_KERNELS(E, T, U, N) \
+    static CARRAY_VECTORIZE double dsum_##N(const T* a, size_t n) \
+    { \
+        if (n > CARRAY_PAIRWISE_BLOCK) { \
+            size_t h = (n / 2) & ~(size_t)7; \
+            return dsum_##N(a, h) + dsum_##N(a + h, n - h); \
+        } else { \
+            double s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0, s6 = 0, s7 = 0; \
+            size_t i; \
+            for (i = 0; i + 8 <= n; i += 8) { \
+                s0 += a[i];     s1 += a[i + 1]; s2 += a[i + 2]; s3 += a[i + 3]; \
+                s4 += a[i + 4]; s5 += a[i + 5]; s6 += a[i + 6]; s7 += a[i + 7]; \
+            } \
+            double s = ((s0 + s1) + (s2 + s3)) + ((s4 + s5) + (s6 + s7)); \
+            for (; i < n; ++i) s += a[i]; \
+            return s; \
+        } \
+    } \
+    static CARRAY_VECTORIZE void minmax_##N(const T* a, size_t n, T* minValue, T* maxValue) \
+    { \
+        size_t i = 0; \
+        while (i < n - 1 && a[i] != a[i]) ++i; \
+        T mn = a[i]; \
+        T mx = a[i]; \
+        for (; i < n; ++i) { \
+            T v = a[i]; \
+            mn = (v < mn) ? v : mn; \
+            mx = (v > mx) ? v : mx; \
+        } \
+        *minValue = mn; \
+        *maxValue = mx; \
+    } \
+    static CARRAY_VECTORIZE size_t indexof_##N(const T* a, size_t n, T v) \
+    { \
+        size_t i = 0, j; \
+        for (; i + CARRAY_SCAN_BLOCK <= n; i += CARRAY_SCAN_BLOCK) { \
+            int found = 0; \
+            for (j = 0; j < CARRAY_SCAN_BLOCK; ++j) found |= (a[i + j] == v); \
+            if (found) break; \
+        } \
+        for (; i < n && a[i] != v; ++i); \
+        return i; \
+    } \
+    static CARRAY_VECTORIZE size_t rindexof_##N(const T* a, size_t n, T v) \
+    { \
+        size_t i = n, j; \
+        for (; i >= CARRAY_SCAN_BLOCK; i -= CARRAY_SCAN_BLOCK) { \
+            int found = 0; \
+            for (j = 0; j < CARRAY_SCAN_BLOCK; ++j) found |= (a[i - CARRAY_SCAN_BLOCK + j] == v); \
+            if (found) break; \
+        } \
+        for (; i > 0 && a[i - 1] != v; --i); \
+        return i; \
+    } \
+    static CARRAY_VECTORIZE size_t countof_##N(const T* a, size_t n, T v) \
+    { \
+        size_t c = 0, i; \
+        for (i = 0; i < n; ++i) c += (a[i] == v); \
+        return c; \
+    }
+
+/**
+ * isum: sum of integer elements, wraps around on overflow.
+ */
+#define CARRAY_INTEGER_SUM(E, T, U, N) \
+    static CARRAY_VECTORIZE MaxUInt isum_##N(const T* a, size_t n) \
+    { \
+        MaxUInt s = 0; \
+        size_t i; \
+        for (i = 0; i < n; ++i) s += (MaxUInt)a[i]; \
+        return s; \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_REDUCE_KERNELS)
+CARRAY_FOR_INTEGER_TYPES(CARRAY_INTEGER_SUM)
+
+/* ============================================================================================ */
+
+static int Carray_sum(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    const void* a = impl->buffer + offset * impl->elementSize;
+
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: lua_pushinteger(L, (lua_Integer)isum_##N(a, count)); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: lua_pushnumber(L, dsum_##N(a, count)); break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_mean(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    if (count == 0) {
+        lua_pushnil(L);
+        return 1;
+    }
+    const void* a = impl->buffer + offset * impl->elementSize;
+
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: lua_pushnumber(L, dsum_##N(a, count) / count); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+typedef enum ExtremumOp ExtremumOp;
+
+enum ExtremumOp
+{
+    EXTREMUM_MIN,
+    EXTREMUM_MAX,
+    EXTREMUM_MINMAX,
+    EXTREMUM_ARGMIN,
+    EXTREMUM_ARGMAX
+};
+
+static int internalExtremum(lua_State* L, ExtremumOp op)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    if (count == 0) {
+        lua_pushnil(L);
+        if (op == EXTREMUM_MINMAX) {
+            lua_pushnil(L);
+            return 2;
+        }
+        return 1;
+    }
+    const void* a     = impl->buffer + offset * impl->elementSize;
+    size_t      index = 0;
+
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N, PUSH) \
+        case E: { \
+            T mn, mx; \
+            minmax_##N(a, count, &mn, &mx); \
+            switch (op) { \
+                case EXTREMUM_MIN:    PUSH(L, mn); return 1; \
+                case EXTREMUM_MAX:    PUSH(L, mx); return 1; \
+                case EXTREMUM_MINMAX: PUSH(L, mn); PUSH(L, mx); return 2; \
+                case EXTREMUM_ARGMIN: index = indexof_##N(a, count, mn); break; \
+                case EXTREMUM_ARGMAX: index = indexof_##N(a, count, mx); break; \
+            } \
+            break; \
+        }
+#define CARRAY_CASE_INTEGER(E, T, U, N) CARRAY_CASE(E, T, U, N, lua_pushinteger)
+#define CARRAY_CASE_FLOAT(E, T, U, N)   CARRAY_CASE(E, T, U, N, lua_pushnumber)
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE_INTEGER)
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE_FLOAT)
+#undef  CARRAY_CASE_FLOAT
+#undef  CARRAY_CASE_INTEGER
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    if (index >= count) {
+        index = 0; /* all elements are NaN */
+    }
+    lua_pushinteger(L, offset + index + 1);
+    return 1;
+}
+
+static int Carray_min(lua_State* L)    { return internalExtremum(L, EXTREMUM_MIN);    }
+static int Carray_max(lua_State* L)    { return internalExtremum(L, EXTREMUM_MAX);    }
+static int Carray_minmax(lua_State* L) { return internalExtremum(L, EXTREMUM_MINMAX); }
+static int Carray_argmin(lua_State* L) { return internalExtremum(L, EXTREMUM_ARGMIN); }
+static int Carray_argmax(lua_State* L) { return internalExtremum(L, EXTREMUM_ARGMAX); }
+
+/* ============================================================================================ */
+
+/**
+ * Sorting is done by LSD radix sort on unsigned integer keys of the same size as the elements.
+ * The keys are ordered like the element values: for signed integers the sign bit is flipped,
+ * for floating point values the sign bit is set for positive values and all bits are flipped 
+ * for negative values. For descending order the keys are inverted. NaN values always get the
+ * largest key, i.e. they are sorted to the end in ascending and descending order.
+ * 
+ * tokeys, fromkeys: conversion between elements and keys, k and a may point to the same buffer.
+ * radixsort:        sorts the keys k and the optional payload x, kt and xt are temporary buffers
+ *                   for n elements. The sort is stable.
+ */
+
+/* arrays with fewer elements are sorted by insertion sort */
+#define CARRAY_SORT_SMALL 64
+
+#define CARRAY_RADIX_SORT(N, K, I, IN) \
+    static void radixsort_##N##_##IN(K* k, K* kt, I* x, I* xt, size_t n) \
+    { \
+        size_t counts[sizeof(K)][256]; \
+        size_t i, b; \
+        if (n < CARRAY_SORT_SMALL) { \
+            for (i = 1; i < n; ++i) { \
+                K      v = k[i]; \
+                I      w = x ? x[i] : 0; \
+                size_t j = i; \
+                for (; j > 0 && k[j - 1] > v; --j) { \
+                    k[j] = k[j - 1]; \
+                    if (x) x[j] = x[j - 1]; \
+                } \
+                k[j] = v; \
+                if (x) x[j] = w; \
+            } \
+            return; \
+        } \
+        memset(counts, 0, sizeof(counts)); \
+        for (i = 0; i < n; ++i) { \
+            K v = k[i]; \
+            for (b = 0; b < sizeof(K); ++b) { \
+                counts[b][(v >> (8 * b)) & 0xff] += 1; \
+            } \
+        } \
+        K* k0 = k; \
+        for (b = 0; b < sizeof(K); ++b) { \
+            size_t* c = counts[b]; \
+            if (c[(k[0] >> (8 * b)) & 0xff] == n) { \
+                continue; /* all keys have the same digit */ \
+            } \
+            size_t sum = 0, d; \
+            for (d = 0; d < 256; ++d) { \
+                size_t t = c[d]; c[d] = sum; sum += t; \
+            } \
+            for (i = 0; i < n; ++i) { \
+                size_t p = c[(k[i] >> (8 * b)) & 0xff]++; \
+                kt[p] = k[i]; \
+                if (x) xt[p] = x[i]; \
+            } \
+            { K* t = k; k = kt; kt = t; } \
+            { I* t = x; x = xt; xt = t; } \
+        } \
+        if (k != k0) { \
+            memcpy(kt, k, n * sizeof(K)); \
+            if (x) memcpy(xt, x, n * sizeof(I)); \
+        } \
+    }
+
+#define CARRAY_INTEGER_SORT_KERNELS(E, T, U, N) \
+    static CARRAY_VECTORIZE void tokeys_##N(U* k, const T* a, size_t n, bool desc) \
+    { \
+        const U flip = (U)(((T)-1 < (T)1 ? (U)1 << (sizeof(U) * CHAR_BIT - 1) : 0) ^ (desc ? (U)-1 : 0)); \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            k[i] = (U)a[i] ^ flip; \
+        } \
+    } \
+    static CARRAY_VECTORIZE void fromkeys_##N(T* a, const U* k, size_t n, bool desc) \
+    { \
+        const U flip = (U)(((T)-1 < (T)1 ? (U)1 << (sizeof(U) * CHAR_BIT - 1) : 0) ^ (desc ? (U)-1 : 0)); \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            a[i] = (T)(U)(k[i] ^ flip); \
+        } \
+    } \
+    CARRAY_RADIX_SORT(N, U, unsigned int, idx32) \
+    CARRAY_RADIX_SORT(N, U, MaxUInt,      idx64)
+
+#define CARRAY_FLOAT_SORT_KERNELS(E, T, K, N) \
+    static CARRAY_VECTORIZE void tokeys_##N(K* k, const T* a, size_t n, bool desc) \
+    { \
+        const K sign = (K)1 << (sizeof(K) * CHAR_BIT - 1); \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            T v = a[i]; \
+            K b; \
+            memcpy(&b, &v, sizeof(b)); \
+            b = (b & sign) ? ~b : (b | sign); \
+            b = desc ? ~b : b; \
+            k[i] = (v != v) ? ~(K)0 : b; \
+        } \
+    } \
+    static CARRAY_VECTORIZE void fromkeys_##N(T* a, const K* k, size_t n, bool desc) \
+    { \
+        const K sign = (K)1 << (sizeof(K) * CHAR_BIT - 1); \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            K b = k[i]; \
+            T v = (T)NAN; \
+            if (b != ~(K)0) { \
+                b = desc ? ~b : b; \
+                b = (b & sign) ? (b & ~sign) : ~b; \
+                memcpy(&v, &b, sizeof(v)); \
+            } \
+            a[i] = v; \
+        } \
+    } \
+    CARRAY_RADIX_SORT(N, K, unsigned int, idx32) \
+    CARRAY_RADIX_SORT(N, K, MaxUInt,      idx64)
+
+/* keys for floating point elements */
+typedef char CarrayCheckFloatKeySize[(sizeof(float)  == sizeof(unsigned int) 
+                                   && sizeof(double) == sizeof(MaxUInt)) ? 1 : -1];
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_INTEGER_SORT_KERNELS)
+CARRAY_FLOAT_SORT_KERNELS(CARRAY_FLOAT,  float,  unsigned int, float)
+CARRAY_FLOAT_SORT_KERNELS(CARRAY_DOUBLE, double, MaxUInt,      double)
+
+/* ============================================================================================ */
+
+static bool checkDescending(lua_State* L, int arg)
+{
+    if (lua_isnoneornil(L, arg)) {
+        return false;
+    }
+    luaL_checktype(L, arg, LUA_TBOOLEAN);
+    return lua_toboolean(L, arg);
+}
+
+/* ============================================================================================ */
+
+/**
+ * Sorts the first count elements of the array impl in place. A temporary buffer is 
+ * pushed onto the stack.
+ */
+static void internalSort(lua_State* L, carray* impl, size_t count, bool desc)
+{
+    if (count > 1) {
+        void* a   = impl->buffer;
+        void* tmp = lua_newuserdata(L, count * impl->elementSize);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: tokeys_##N(a, a, count, desc); \
+                                        radixsort_##N##_idx32(a, tmp, NULL, NULL, count); \
+                                        fromkeys_##N(a, a, count, desc); \
+                                        break;
+            CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+}
+
+static int Carray_sort(lua_State* L)
+{
+    carray* impl  = checkWritableUdata(L, 1)->impl;
+    bool    desc  = checkDescending(L, 2);
+    internalSort(L, impl, impl->elementCount, desc);
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Element type for arrays of positions up to maxPosition: unsigned int if possible, 
+ * otherwise a 64-bit unsigned integer type, i.e. the elements are unsigned int or MaxUInt.
+ */
+static carray_type positionType(size_t maxPosition)
+{
+    return (maxPosition > UINT_MAX) ? CARRAY_MAXUINT : CARRAY_UINT;
+}
+
+/* ============================================================================================ */
+
+static int Carray_argsort(lua_State* L)
+{
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    bool    desc  = checkDescending(L, 2);
+    size_t  count = impl->elementCount;
+    bool    wide  = (count > UINT_MAX);
+    carray* rslt  = carray_capi_impl.newCarray(L, positionType(count), CARRAY_DEFAULT, count, NULL); /* -> rslt */
+    if (!rslt) {
+        return luaL_error(L, "cannot create carray");
+    }
+    if (count > 0) {
+        size_t i;
+        size_t keySize = (count * impl->elementSize + 7) & ~(size_t)7; /* aligned for all types */
+        void*  k   = lua_newuserdata(L, 2 * keySize + count * rslt->elementSize);
+        void*  kt  = (char*)k  + keySize;
+        void*  xt  = (char*)kt + keySize;
+        void*  x   = rslt->buffer;
+        if (wide) {
+            for (i = 0; i < count; ++i) ((MaxUInt*)x)[i] = i + 1;
+        } else {
+            for (i = 0; i < count; ++i) ((unsigned int*)x)[i] = i + 1;
+        }
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: tokeys_##N(k, (const T*)impl->buffer, count, desc); \
+                                        if (wide) radixsort_##N##_idx64(k, kt, x, xt, count); \
+                                        else      radixsort_##N##_idx32(k, kt, x, xt, count); \
+                                        break;
+            CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+        lua_pop(L, 1);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Index kernels for integer index arrays p of any element type with 0- or 1-based
+ * positions (base = 0 or 1):
+ * 
+ * checkindices: returns true if all n > 0 positions are within count elements. The 
+ *               minimum and maximum are determined in one vectorizable pass, so the
+ *               gather and scatter loops do not need bounds checking.
+ * gather:       d[i] = s[p[i] - base] for elements of the given size.
+ * scatter:      d[p[i] - base] = s[i * stride] for elements of the given size, stride is 
+ *               0 for scattering the same element value or 1.
+ *
+ * The loops for element sizes 1, 2, 4 and 8 are instantiated separately to allow
+ * the compiler to use plain loads or vector gather instructions.
+ */
+#define CARRAY_GATHER_LOOP(U, SIZE) \
+    for (i = 0; i < n; ++i) { \
+        memcpy(d + i * SIZE, s + ((MaxUInt)(U)p[i] - base) * SIZE, SIZE); \
+    } \
+    break;
+
+#define CARRAY_SCATTER_LOOP(U, SIZE) \
+    for (i = 0; i < n; ++i) { \
+        memcpy(d + ((MaxUInt)(U)p[i] - base) * SIZE, s + i * stride * SIZE, SIZE); \
+    } \
+    break;
+
+#define CARRAY_INDEX_KERNELS(E, T, U, N) \
+    static CARRAY_VECTORIZE bool checkindices_##N(const T* p, size_t n, MaxUInt base, size_t count) \
+    { \
+        T lo = p[0]; \
+        T hi = p[0]; \
+        size_t i; \
+        for (i = 1; i < n; ++i) { \
+            lo = (p[i] < lo) ? p[i] : lo; \
+            hi = (p[i] > hi) ? p[i] : hi; \
+        } \
+        return lo >= (T)base && (MaxUInt)(U)hi - base < count; \
+    } \
+    static CARRAY_VECTORIZE void gather_##N(char* d, const char* s, size_t elementSize, const T* p, size_t n, MaxUInt base) \
+    { \
+        size_t i; \
+        switch (elementSize) { \
+            case 1:  CARRAY_GATHER_LOOP(U, 1) \
+            case 2:  CARRAY_GATHER_LOOP(U, 2) \
+            case 4:  CARRAY_GATHER_LOOP(U, 4) \
+            case 8:  CARRAY_GATHER_LOOP(U, 8) \
+            default: CARRAY_GATHER_LOOP(U, elementSize) \
+        } \
+    } \
+    static void scatter_##N(char* d, const char* s, size_t stride, size_t elementSize, const T* p, size_t n, MaxUInt base) \
+    { \
+        size_t i; \
+        switch (elementSize) { \
+            case 1:  CARRAY_SCATTER_LOOP(U, 1) \
+            case 2:  CARRAY_SCATTER_LOOP(U, 2) \
+            case 4:  CARRAY_SCATTER_LOOP(U, 4) \
+            case 8:  CARRAY_SCATTER_LOOP(U, 8) \
+            default: CARRAY_SCATTER_LOOP(U, elementSize) \
+        } \
+    }
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_INDEX_KERNELS)
+
+/* ============================================================================================ */
+
+/**
+ * Checks the index array at stack index arg and its positions for the given base
+ * against count elements.
+ */
+static carray* checkIndices(lua_State* L, int arg, MaxUInt base, size_t count)
+{
+    carray* indices = checkReadableUdata(L, arg)->impl;
+    bool    ok      = false;
+    if (!indices->isInteger) {
+        luaL_argerror(L, arg, "integer carray expected");
+    }
+    if (indices->elementCount == 0) {
+        return indices;
+    }
+    switch (indices->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: ok = checkindices_##N((const T*)indices->buffer, indices->elementCount, base, count); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, arg, "unsupported element type");
+    }
+    if (!ok) {
+        luaL_argerror(L, arg, "index out of bounds");
+    }
+    return indices;
+}
+
+static MaxUInt checkIndexBase(lua_State* L, int arg)
+{
+    lua_Integer base = luaL_optinteger(L, arg, 1);
+    if (base != 0 && base != 1) {
+        luaL_argerror(L, arg, "0 or 1 expected");
+    }
+    return (MaxUInt)base;
+}
+
+static void internalGather(lua_State* L, char* d, const char* s, size_t elementSize, carray* indices, MaxUInt base)
+{
+    switch (indices->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: gather_##N(d, s, elementSize, (const T*)indices->buffer, indices->elementCount, base); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+/* ============================================================================================ */
+
+static int Carray_permute(lua_State* L)
+{
+    carray* impl  = checkWritableUdata(L, 1)->impl;
+    size_t  count = impl->elementCount;
+    carray* perm  = checkReadableUdata(L, 2)->impl;
+    if (perm->isInteger && perm->elementCount != count) {
+        return luaL_argerror(L, 2, "carray length mismatch");
+    }
+    checkIndices(L, 2, 1, count);
+    if (count > 0) {
+        char* tmp = lua_newuserdata(L, count * impl->elementSize);
+        internalGather(L, tmp, impl->buffer, impl->elementSize, perm, 1);
+        memcpy(impl->buffer, tmp, count * impl->elementSize);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/* sort order of the elements as in array:sort(), i.e. NaN is greater than all other values */
+#define CARRAY_LESS_INTEGER(a, b) ((a) < (b))
+#define CARRAY_LESS_FLOAT(a, b)   ((a) < (b) || ((a) == (a) && (b) != (b)))
+
+/**
+ * search: branchless binary search in the sorted elements a for each of the m values in v. 
+ * Stores the number of elements that are less than (or less or equal if right is true) 
+ * the value plus 1, i.e. the 1-based insertion position, in p. The memory locations for 
+ * both possible next steps are prefetched.
+ */
+#define CARRAY_SEARCH_KERNELS(E, T, U, N, LESS) \
+    static CARRAY_INLINE size_t searchone_##N(const T* a, size_t n, T v, bool right) \
+    { \
+        const T* base = a; \
+        if (n == 0) { \
+            return 1; \
+        } \
+        if (right) { \
+            while (n > 1) { \
+                size_t half = n / 2; \
+                CARRAY_PREFETCH(base + half / 2); \
+                CARRAY_PREFETCH(base + half + half / 2); \
+                base = LESS(v, base[half]) ? base : base + half; \
+                n -= half; \
+            } \
+            return (base - a) + !LESS(v, *base) + 1; \
+        } else { \
+            while (n > 1) { \
+                size_t half = n / 2; \
+                CARRAY_PREFETCH(base + half / 2); \
+                CARRAY_PREFETCH(base + half + half / 2); \
+                base = LESS(base[half], v) ? base + half : base; \
+                n -= half; \
+            } \
+            return (base - a) + LESS(*base, v) + 1; \
+        } \
+    } \
+    static void search_##N(const T* a, size_t n, const T* v, size_t m, bool right, void* p, bool wide) \
+    { \
+        size_t i; \
+        if (wide) { \
+            for (i = 0; i < m; ++i) ((MaxUInt*)p)[i]      = searchone_##N(a, n, v[i], right); \
+        } else { \
+            for (i = 0; i < m; ++i) ((unsigned int*)p)[i] = searchone_##N(a, n, v[i], right); \
+        } \
+    }
+
+#define CARRAY_SEARCH_INTEGER(E, T, U, N) CARRAY_SEARCH_KERNELS(E, T, U, N, CARRAY_LESS_INTEGER)
+#define CARRAY_SEARCH_FLOAT(E, T, U, N)   CARRAY_SEARCH_KERNELS(E, T, U, N, CARRAY_LESS_FLOAT)
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_SEARCH_INTEGER)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_SEARCH_FLOAT)
+
+/* ============================================================================================ */
+
+static int Carray_searchsorted(lua_State* L)
+{
+    static const char* const sideNames[] = { "left", "right", NULL };
+    
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    bool    right = luaL_checkoption(L, 3, "left", sideNames) == 1;
+    size_t  count = impl->elementCount;
+    const void* a = impl->buffer;
+    
+    if (luaL_testudata(L, 2, CARRAY_CLASS_NAME)) {
+        carray* values = checkReadableUdata(L, 2)->impl;
+        if (values->elementType != impl->elementType) {
+            return luaL_argerror(L, 2, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl)));
+        }
+        size_t  m    = values->elementCount;
+        carray* rslt = carray_capi_impl.newCarray(L, positionType(count + 1), CARRAY_DEFAULT, m, NULL); /* -> rslt */
+        if (!rslt) {
+            return luaL_error(L, "cannot create carray");
+        }
+        if (m > 0) {
+            bool wide = (rslt->elementType != CARRAY_UINT);
+            switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: search_##N(a, count, (const T*)values->buffer, m, right, rslt->buffer, wide); break;
+                CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+                default: return luaL_argerror(L, 1, "unsupported element type");
+            }
+        }
+        return 1;
+    }
+    size_t pos = 0;
+    if (impl->isInteger) {
+        if (!lua_isinteger(L, 2)) {
+            return luaL_argerror(L, 2, "integer or carray expected");
+        }
+        lua_Integer v = lua_tointeger(L, 2);
+        if (impl->elementSize < sizeof(lua_Integer)) {
+            lua_Integer s = saturateInteger(impl, v);
+            if (s != v) {
+                /* value is out of the element type's range */
+                lua_pushinteger(L, (v < s) ? 1 : count + 1);
+                return 1;
+            }
+        }
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: pos = searchone_##N(a, count, (T)v, right); break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    } else {
+        if (lua_type(L, 2) != LUA_TNUMBER) {
+            return luaL_argerror(L, 2, "number or carray expected");
+        }
+        lua_Number v = lua_tonumber(L, 2);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: pos = searchone_##N(a, count, (T)v, right); break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    lua_pushinteger(L, pos);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/* equality of elements for unique(), dedup() and runs(), i.e. all NaN values are equal */
+#define CARRAY_EQUAL_INTEGER(a, b) ((a) == (b))
+#define CARRAY_EQUAL_FLOAT(a, b)   ((a) == (b) || ((a) != (a) && (b) != (b)))
+
+/**
+ * issorted:  returns true if the n elements are in ascending order as in array:sort(),
+ *            the elements are checked in blocks to stop early for unsorted input.
+ * countruns: returns the number of runs of equal consecutive elements for n > 0.
+ * dedup:     copies the first element of each run to d and returns the number of 
+ *            runs for n > 0, d may be the same as a.
+ * runs:      stores the first element and the length of each run in v and len for n > 0,
+ *            the lengths are of type unsigned int or MaxUInt if wide is true.
+ */
+#define CARRAY_UNIQUE_KERNELS(E, T, U, N, LESS, EQUAL) \
+    static CARRAY_VECTORIZE bool issorted_##N(const T* a, size_t n) \
+    { \
+        size_t i = 1; \
+        while (i < n) { \
+            size_t m = (n - i < CARRAY_SCAN_BLOCK) ? n - i : CARRAY_SCAN_BLOCK; \
+            size_t k; \
+            bool unsorted = false; \
+            for (k = 0; k < m; ++k) { \
+                unsorted |= LESS(a[i + k], a[i + k - 1]); \
+            } \
+            if (unsorted) { \
+                return false; \
+            } \
+            i += m; \
+        } \
+        return true; \
+    } \
+    static CARRAY_VECTORIZE size_t countruns_##N(const T* a, size_t n) \
+    { \
+        size_t i, r = 1; \
+        for (i = 1; i < n; ++i) { \
+            r += !EQUAL(a[i], a[i - 1]); \
+        } \
+        return r; \
+    } \
+    static size_t dedup_##N(T* d, const T* a, size_t n) \
+    { \
+        size_t i, j = 0; \
+        d[0] = a[0]; \
+        for (i = 1; i < n; ++i) { \
+            T    v  = a[i]; \
+            bool ne = !EQUAL(v, a[i - 1]); \
+            j += ne; \
+            d[j] = ne ? v : d[j]; \
+        } \
+        return j + 1; \
+    } \
+    static void runs_##N(T* v, void* len, bool wide, const T* a, size_t n) \
+    { \
+        size_t i, j = 0, start = 0; \
+        v[0] = a[0]; \
+        for (i = 1; i < n; ++i) { \
+            if (!EQUAL(a[i], a[i - 1])) { \
+                if (wide) ((MaxUInt*)len)[j]      = i - start; \
+                else      ((unsigned int*)len)[j] = i - start; \
+                v[++j] = a[i]; \
+                start  = i; \
+            } \
+        } \
+        if (wide) ((MaxUInt*)len)[j]      = n - start; \
+        else      ((unsigned int*)len)[j] = n - start; \
+    }
+
+#define CARRAY_UNIQUE_INTEGER(E, T, U, N) CARRAY_UNIQUE_KERNELS(E, T, U, N, CARRAY_LESS_INTEGER, CARRAY_EQUAL_INTEGER)
+#define CARRAY_UNIQUE_FLOAT(E, T, U, N)   CARRAY_UNIQUE_KERNELS(E, T, U, N, CARRAY_LESS_FLOAT,   CARRAY_EQUAL_FLOAT)
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_UNIQUE_INTEGER)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_UNIQUE_FLOAT)
+
+/* ============================================================================================ */
+
+static size_t internalDedup(lua_State* L, carray* dst, const carray* src, size_t count)
+{
+    if (count == 0) {
+        return 0;
+    }
+    switch (src->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: return dedup_##N((T*)dst->buffer, (const T*)src->buffer, count);
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 0;
+}
+
+static size_t internalCountRuns(lua_State* L, const carray* impl)
+{
+    if (impl->elementCount == 0) {
+        return 0;
+    }
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: return countruns_##N((const T*)impl->buffer, impl->elementCount);
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 0;
+}
+
+/* ============================================================================================ */
+
+static int Carray_unique(lua_State* L)
+{
+    carray* impl   = checkReadableUdata(L, 1)->impl;
+    size_t  count  = impl->elementCount;
+    bool    sorted = true;
+    lua_settop(L, 2);
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: sorted = issorted_##N((const T*)impl->buffer, count); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    carray* dst = pushDestination(L, 2, impl->elementType, sorted ? internalCountRuns(L, impl) : count);
+    if (sorted) {
+        /* linear for sorted input */
+        internalDedup(L, dst, impl, count);
+    } else {
+        if (dst != impl) {
+            memcpy(dst->buffer, impl->buffer, count * impl->elementSize);
+        }
+        internalSort(L, dst, count, false);
+        size_t n = internalDedup(L, dst, dst, count);
+        if (!carray_resize(dst, n, 0) && n > 0) {
+            return luaL_error(L, "resizing carray failed");
+        }
+        lua_settop(L, 3);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_dedup(lua_State* L)
+{
+    carray* impl  = checkWritableUdata(L, 1)->impl;
+    size_t  count = impl->elementCount;
+    size_t  n     = internalCountRuns(L, impl);
+    if (n < count) {
+        if (!carray_is_resizable(impl)) {
+            return luaL_error(L, "resizing carray failed");
+        }
+        internalDedup(L, impl, impl, count);
+        carray_resize(impl, n, 0);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_runs(lua_State* L)
+{
+    carray* impl   = checkReadableUdata(L, 1)->impl;
+    size_t  count  = impl->elementCount;
+    size_t  n      = internalCountRuns(L, impl);
+    carray* values = carray_capi_impl.newCarray(L, impl->elementType, CARRAY_DEFAULT, n, NULL); /* -> values */
+    if (!values) {
+        return luaL_error(L, "cannot create carray");
+    }
+    carray* lens = carray_capi_impl.newCarray(L, positionType(count), CARRAY_DEFAULT, n, NULL); /* -> values, lens */
+    if (!lens) {
+        return luaL_error(L, "cannot create carray");
+    }
+    if (n > 0) {
+        bool wide = (lens->elementType != CARRAY_UINT);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: runs_##N((T*)values->buffer, lens->buffer, wide, (const T*)impl->buffer, count); break;
+            CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    return 2;
+}
+
+/* ============================================================================================ */
+
+typedef enum FindOp FindOp;
+
+enum FindOp
+{
+    FIND_FIRST,
+    FIND_LAST,
+    FIND_COUNT
+};
+
+/**
+ * Searches the n elements at a for the value at stack index arg. For FIND_FIRST the index 
+ * of the first match or n is returned, for FIND_LAST the index + 1 of the last match or 0, 
+ * for FIND_COUNT the number of matches. Values that cannot be represented by the element 
+ * type are never found.
+ */
+static size_t internalFind(lua_State* L, FindOp op, carray* impl, int arg, const char* a, size_t n)
+{
+    size_t notFound = (op == FIND_FIRST) ? n : 0;
+    if (impl->isInteger) {
+        lua_Integer v = checkInteger(L, arg);
+        if (n == 0 || (impl->elementSize < sizeof(lua_Integer) && saturateInteger(impl, v) != v)) {
+            return notFound;
+        }
+        if (op == FIND_FIRST && impl->elementSize == 1) {
+            const char* p = memchr(a, (unsigned char)v, n);
+            return p ? (size_t)(p - a) : n;
+        }
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) \
+            case E: switch (op) { \
+                case FIND_FIRST: return indexof_##N((const T*)a, n, (T)v); \
+                case FIND_LAST:  return rindexof_##N((const T*)a, n, (T)v); \
+                case FIND_COUNT: return countof_##N((const T*)a, n, (T)v); \
+            } \
+            break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: break;
+        }
+    } else {
+        lua_Number v = luaL_checknumber(L, arg);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) \
+            case E: if ((T)v != v) { \
+                        return notFound; \
+                    } \
+                    switch (op) { \
+                        case FIND_FIRST: return indexof_##N((const T*)a, n, (T)v); \
+                        case FIND_LAST:  return rindexof_##N((const T*)a, n, (T)v); \
+                        case FIND_COUNT: return countof_##N((const T*)a, n, (T)v); \
+                    } \
+                    break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: break;
+        }
+    }
+    luaL_argerror(L, 1, "unsupported element type");
+    return notFound;
+}
+
+/* ============================================================================================ */
+
+static int Carray_find(lua_State* L)
+{
+    carray*     impl  = checkReadableUdata(L, 1)->impl;
+    size_t      count = impl->elementCount;
+    lua_Integer init  = luaL_optinteger(L, 3, 1);
+    if (init < 0) {
+        init = count + init + 1;
+    }
+    if (init < 1) {
+        init = 1;
+    }
+    size_t offset = init - 1;
+    if (init > (lua_Integer)count) {
+        offset = count;
+    }
+    size_t index = internalFind(L, FIND_FIRST, impl, 2, impl->buffer + offset * impl->elementSize, 
+                                                        count - offset);
+    if (offset + index < count) {
+        lua_pushinteger(L, offset + index + 1);
+    } else {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_rfind(lua_State* L)
+{
+    carray*     impl  = checkReadableUdata(L, 1)->impl;
+    size_t      count = impl->elementCount;
+    lua_Integer init  = luaL_optinteger(L, 3, -1);
+    if (init < 0) {
+        init = count + init + 1;
+    }
+    if (init < 0) {
+        init = 0;
+    }
+    if (init > (lua_Integer)count) {
+        init = count;
+    }
+    size_t pos = internalFind(L, FIND_LAST, impl, 2, impl->buffer, init);
+    if (pos > 0) {
+        lua_pushinteger(L, pos);
+    } else {
+        lua_pushnil(L);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_count(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    lua_pushinteger(L, internalFind(L, FIND_COUNT, impl, 2, impl->buffer + offset * impl->elementSize, count));
+    return 1;
+}
+
+/* ============================================================================================ */
+
+typedef enum ArithOp ArithOp;
+
+enum ArithOp
+{
+    ARITH_ADD,
+    ARITH_SUB,
+    ARITH_MUL,
+    ARITH_DIV
+};
+
+/**
+ * Elementwise arithmetic d[i] = a[i] op b[i] or d[i] = a[i] op x if b is NULL.
+ * Integer arithmetic wraps around, integer division truncates toward zero.
+ * Returns false on integer division by zero.
+ */
+#define CARRAY_INTEGER_ARITH(E, T, U, N) \
+    static CARRAY_VECTORIZE bool arith_##N(ArithOp op, T* d, const T* a, const T* b, T x, size_t n) \
+    { \
+        size_t i; \
+        if (b) { \
+            switch (op) { \
+                case ARITH_ADD: for (i = 0; i < n; ++i) d[i] = (T)((U)a[i] + (U)b[i]); break; \
+                case ARITH_SUB: for (i = 0; i < n; ++i) d[i] = (T)((U)a[i] - (U)b[i]); break; \
+                case ARITH_MUL: for (i = 0; i < n; ++i) d[i] = (T)(1u * (U)a[i] * (U)b[i]); break; \
+                case ARITH_DIV: { \
+                    bool hasZero = false; \
+                    for (i = 0; i < n; ++i) hasZero |= (b[i] == 0); \
+                    if (hasZero) return false; \
+                    for (i = 0; i < n; ++i) d[i] = ((T)-1 < (T)1 && b[i] == (T)-1) ? (T)(0 - (U)a[i]) : (T)(a[i] / b[i]); \
+                    break; \
+                } \
+            } \
+        } else { \
+            switch (op) { \
+                case ARITH_ADD: for (i = 0; i < n; ++i) d[i] = (T)((U)a[i] + (U)x); break; \
+                case ARITH_SUB: for (i = 0; i < n; ++i) d[i] = (T)((U)a[i] - (U)x); break; \
+                case ARITH_MUL: for (i = 0; i < n; ++i) d[i] = (T)(1u * (U)a[i] * (U)x); break; \
+                case ARITH_DIV: { \
+                    if (x == 0) return false; \
+                    if ((T)-1 < (T)1 && x == (T)-1) { \
+                        for (i = 0; i < n; ++i) d[i] = (T)(0 - (U)a[i]); \
+                    } else { \
+                        for (i = 0; i < n; ++i) d[i] = (T)(a[i] / x); \
+                    } \
+                    break; \
+                } \
+            } \
+        } \
+        return true; \
+    }
+
+#define CARRAY_FLOAT_ARITH(E, T, U, N) \
+    static CARRAY_VECTORIZE bool arith_##N(ArithOp op, T* d, const T* a, const T* b, T x, size_t n) \
+    { \
+        size_t i; \
+        if (b) { \
+            switch (op) { \
+                case ARITH_ADD: for (i = 0; i < n; ++i) d[i] = a[i] + b[i]; break; \
+                case ARITH_SUB: for (i = 0; i < n; ++i) d[i] = a[i] - b[i]; break; \
+                case ARITH_MUL: for (i = 0; i < n; ++i) d[i] = a[i] * b[i]; break; \
+                case ARITH_DIV: for (i = 0; i < n; ++i) d[i] = a[i] / b[i]; break; \
+            } \
+        } else { \
+            switch (op) { \
+                case ARITH_ADD: for (i = 0; i < n; ++i) d[i] = a[i] + x; break; \
+                case ARITH_SUB: for (i = 0; i < n; ++i) d[i] = a[i] - x; break; \
+                case ARITH_MUL: for (i = 0; i < n; ++i) d[i] = a[i] * x; break; \
+                case ARITH_DIV: for (i = 0; i < n; ++i) d[i] = a[i] / x; break; \
+            } \
+        } \
+        return true; \
+    }
+
+#define CARRAY_CLAMP(E, T, U, N) \
+    static CARRAY_VECTORIZE void clamp_##N(T* d, const T* a, T lo, T hi, size_t n) \
+    { \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            T v = a[i]; \
+            v = (v < lo) ? lo : v; \
+            d[i] = (v > hi) ? hi : v; \
+        } \
+    }
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_INTEGER_ARITH)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_FLOAT_ARITH)
+CARRAY_FOR_ALL_TYPES(CARRAY_CLAMP)
+
+/* ============================================================================================ */
+
+/**
+ * Evaluates the operand at stack index arg for elementwise operations on count elements 
+ * of the array impl: the operand may be a scalar number or an array of the same element
+ * type with count elements. For array operands a pointer to the elements is returned, 
+ * otherwise NULL is returned and the scalar value is stored in ix or nx.
+ */
+static const void* checkOperand(lua_State* L, int arg, carray* impl, size_t count, lua_Integer* ix, lua_Number* nx)
+{
+    CarrayUserData* other = luaL_testudata(L, arg, CARRAY_CLASS_NAME);
+    if (other) {
+        if (!other->impl) {
+            luaL_argerror(L, arg, "invalid carray");
+        }
+        if (other->impl->elementType != impl->elementType) {
+            luaL_argerror(L, arg, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl)));
+        }
+        if (other->impl->elementCount != count) {
+            luaL_argerror(L, arg, "carray length mismatch");
+        }
+        return other->impl->buffer;
+    }
+    if (impl->isInteger) {
+        if (!lua_isinteger(L, arg)) {
+            luaL_argerror(L, arg, "integer or carray expected");
+        }
+        *ix = lua_tointeger(L, arg);
+    } else {
+        if (lua_type(L, arg) != LUA_TNUMBER) {
+            luaL_argerror(L, arg, "number or carray expected");
+        }
+        *nx = lua_tonumber(L, arg);
+    }
+    return NULL;
+}
+
+/* ============================================================================================ */
+
+static void internalArith(lua_State* L, ArithOp op, carray* dst, size_t dstOffset, 
+                                                    carray* src, size_t srcOffset, size_t count,
+                                                    const void* b, lua_Integer ix, lua_Number nx)
+{
+    if (count == 0) {
+        return;
+    }
+    void*       d  = dst->buffer + dstOffset * dst->elementSize;
+    const void* a  = src->buffer + srcOffset * src->elementSize;
+    bool        ok = false;
+
+    switch (src->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: ok = arith_##N(op, d, a, b, (T)ix, count); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: ok = arith_##N(op, d, a, b, (T)nx, count); break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+    if (!ok) {
+        luaL_error(L, "integer division by zero");
+    }
+}
+
+/* ============================================================================================ */
+
+static void internalClamp(lua_State* L, carray* dst, size_t dstOffset, 
+                                        carray* src, size_t srcOffset, size_t count, int loArg)
+{
+    lua_Integer ilo = 0, ihi = 0;
+    lua_Number  nlo = 0, nhi = 0;
+    if (src->isInteger) {
+        ilo = saturateInteger(src, luaL_checkinteger(L, loArg));
+        ihi = saturateInteger(src, luaL_checkinteger(L, loArg + 1));
+        if (ilo > ihi) {
+            luaL_argerror(L, loArg, "lower bound greater than upper bound");
+        }
+    } else {
+        nlo = luaL_checknumber(L, loArg);
+        nhi = luaL_checknumber(L, loArg + 1);
+        if (nlo > nhi) {
+            luaL_argerror(L, loArg, "lower bound greater than upper bound");
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+    void*       d  = dst->buffer + dstOffset * dst->elementSize;
+    const void* a  = src->buffer + srcOffset * src->elementSize;
+
+    switch (src->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: clamp_##N(d, a, (T)ilo, (T)ihi, count); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: clamp_##N(d, a, (T)nlo, (T)nhi, count); break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+/* ============================================================================================ */
+
+static int arithMethod(lua_State* L, ArithOp op)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    lua_Integer ix = 0;
+    lua_Number  nx = 0;
+    const void* b  = checkOperand(L, 2, impl, count, &ix, &nx);
+    internalArith(L, op, impl, offset, impl, offset, count, b, ix, nx);
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int Carray_add(lua_State* L) { return arithMethod(L, ARITH_ADD); }
+static int Carray_sub(lua_State* L) { return arithMethod(L, ARITH_SUB); }
+static int Carray_mul(lua_State* L) { return arithMethod(L, ARITH_MUL); }
+static int Carray_div(lua_State* L) { return arithMethod(L, ARITH_DIV); }
+
+/* ============================================================================================ */
+
+static int Carray_clamp(lua_State* L)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 4, impl->elementCount, &offset, &count);
+    internalClamp(L, impl, offset, impl, offset, count, 2);
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int arithFunction(lua_State* L, ArithOp op)
+{
+    carray*     src   = checkReadableUdata(L, 1)->impl;
+    size_t      count = src->elementCount;
+    lua_Integer ix    = 0;
+    lua_Number  nx    = 0;
+    const void* b     = checkOperand(L, 2, src, count, &ix, &nx);
+    carray*     dst   = pushDestination(L, 3, src->elementType, count);
+    internalArith(L, op, dst, 0, src, 0, count, b, ix, nx);
+    return 1;
+}
+
+static int Module_add(lua_State* L) { return arithFunction(L, ARITH_ADD); }
+static int Module_sub(lua_State* L) { return arithFunction(L, ARITH_SUB); }
+static int Module_mul(lua_State* L) { return arithFunction(L, ARITH_MUL); }
+static int Module_div(lua_State* L) { return arithFunction(L, ARITH_DIV); }
+
+/* ============================================================================================ */
+
+static int Module_clamp(lua_State* L)
+{
+    carray* src   = checkReadableUdata(L, 1)->impl;
+    size_t  count = src->elementCount;
+    carray* dst   = pushDestination(L, 4, src->elementType, count);
+    internalClamp(L, dst, 0, src, 0, count, 2);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Module_convert(lua_State* L)
+{
+    int arg = 1;
+    carray* src   = checkReadableUdata(L, arg++)->impl;
+    size_t  count = src->elementCount;
+    
+    int     dstArg  = arg++;
+    carray_type dstType = 0;
+    if (lua_type(L, dstArg) == LUA_TSTRING) {
+        dstType = checkElementType(L, dstArg);
+        if (!dstType) {
+            return luaL_error(L, "cannot create carray for type '%s'", lua_tostring(L, dstArg));
+        }
+    } else {
+        dstType = checkWritableUdata(L, dstArg)->impl->elementType;
+    }
+    lua_Number scale  = luaL_optnumber(L, arg++, 1);
+    lua_Number offset = luaL_optnumber(L, arg++, 0);
+    bool saturate = true;
+    if (!lua_isnoneornil(L, arg)) {
+        luaL_checktype(L, arg, LUA_TBOOLEAN);
+        saturate = lua_toboolean(L, arg);
+    }
+    carray* dst;
+    if (lua_type(L, dstArg) == LUA_TSTRING) {
+        dst = carray_capi_impl.newCarray(L, dstType, CARRAY_DEFAULT, count, NULL);
+        if (!dst) {
+            return luaL_error(L, "cannot create carray for type '%s'", lua_tostring(L, dstArg));
+        }
+    } else {
+        dst = pushDestination(L, dstArg, dstType, count);
+    }
+    if (count == 0) {
+        return 1;
+    }
+    bool ok = true;
+    if (scale != 1 || offset != 0) {
+        ok = convertElementsScaled(dst->elementType, dst->buffer, dst->elementSize,
+                                   src->elementType, src->buffer, src->elementSize,
+                                   count, scale, offset, saturate);
+    }
+    else if (dst->elementType != src->elementType) {
+        ok = convertElements(dst->elementType, dst->buffer, src->elementType, src->buffer, count, saturate);
+    }
+    else if (dst != src) {
+        memcpy(dst->buffer, src->buffer, count * src->elementSize);
+    }
+    if (!ok) {
+        return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+typedef enum ScanOp ScanOp;
+
+enum ScanOp
+{
+    SCAN_SUM,
+    SCAN_EXSUM,
+    SCAN_PROD,
+    SCAN_MAX,
+    SCAN_MIN
+};
+
+/**
+ * Cumulative operations d[i] = a[0] op ... op a[i], d and a may be the same buffer.
+ * SCAN_EXSUM is the exclusive sum d[i] = a[0] + ... + a[i - 1] with d[0] = 0.
+ * Integer sums and products wrap around, floating point values are accumulated
+ * as double. SCAN_MAX and SCAN_MIN ignore NaN values after the first non NaN value.
+ */
+#define CARRAY_SCAN(E, T, U, N, ACC, MUL) \
+    static void scan_##N(ScanOp op, T* d, const T* a, size_t n) \
+    { \
+        size_t i; \
+        if (n == 0) { \
+            return; \
+        } \
+        switch (op) { \
+            case SCAN_SUM: { \
+                ACC s = 0; \
+                for (i = 0; i < n; ++i) { s = (ACC)(s + (ACC)a[i]); d[i] = (T)s; } \
+                break; \
+            } \
+            case SCAN_EXSUM: { \
+                ACC s = 0; \
+                for (i = 0; i < n; ++i) { T v = a[i]; d[i] = (T)s; s = (ACC)(s + (ACC)v); } \
+                break; \
+            } \
+            case SCAN_PROD: { \
+                ACC s = 1; \
+                for (i = 0; i < n; ++i) { s = MUL(s, (ACC)a[i]); d[i] = (T)s; } \
+                break; \
+            } \
+            case SCAN_MAX: { \
+                T m = a[0]; \
+                for (i = 0; i < n; ++i) { T v = a[i]; m = (v > m || m != m) ? v : m; d[i] = m; } \
+                break; \
+            } \
+            case SCAN_MIN: { \
+                T m = a[0]; \
+                for (i = 0; i < n; ++i) { T v = a[i]; m = (v < m || m != m) ? v : m; d[i] = m; } \
+                break; \
+            } \
+        } \
+    }
+
+#define CARRAY_MUL_INTEGER(a, b) (1u * (a) * (b))
+#define CARRAY_MUL_FLOAT(a, b)   ((a) * (b))
+
+#define CARRAY_SCAN_INTEGER(E, T, U, N) CARRAY_SCAN(E, T, U, N, U,      CARRAY_MUL_INTEGER)
+#define CARRAY_SCAN_FLOAT(E, T, U, N)   CARRAY_SCAN(E, T, U, N, double, CARRAY_MUL_FLOAT)
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_SCAN_INTEGER)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_SCAN_FLOAT)
+
+/* ============================================================================================ */
+
+static void internalScan(lua_State* L, ScanOp op, carray* dst, size_t dstOffset, 
+                                                  carray* src, size_t srcOffset, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    void*       d = dst->buffer + dstOffset * dst->elementSize;
+    const void* a = src->buffer + srcOffset * src->elementSize;
+
+    switch (src->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: scan_##N(op, d, a, count); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+/* ============================================================================================ */
+
+static int scanMethod(lua_State* L, ScanOp op)
+{
+    carray* impl = checkWritableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    internalScan(L, op, impl, offset, impl, offset, count);
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int Carray_cumsum(lua_State* L)   { return scanMethod(L, SCAN_SUM);   }
+static int Carray_excumsum(lua_State* L) { return scanMethod(L, SCAN_EXSUM); }
+static int Carray_cumprod(lua_State* L)  { return scanMethod(L, SCAN_PROD);  }
+static int Carray_cummax(lua_State* L)   { return scanMethod(L, SCAN_MAX);   }
+static int Carray_cummin(lua_State* L)   { return scanMethod(L, SCAN_MIN);   }
+
+/* ============================================================================================ */
+
+static int scanFunction(lua_State* L, ScanOp op)
+{
+    carray* src   = checkReadableUdata(L, 1)->impl;
+    size_t  count = src->elementCount;
+    carray* dst   = pushDestination(L, 2, src->elementType, count);
+    internalScan(L, op, dst, 0, src, 0, count);
+    return 1;
+}
+
+static int Module_cumsum(lua_State* L)   { return scanFunction(L, SCAN_SUM);   }
+static int Module_excumsum(lua_State* L) { return scanFunction(L, SCAN_EXSUM); }
+static int Module_cumprod(lua_State* L)  { return scanFunction(L, SCAN_PROD);  }
+static int Module_cummax(lua_State* L)   { return scanFunction(L, SCAN_MAX);   }
+static int Module_cummin(lua_State* L)   { return scanFunction(L, SCAN_MIN);   }
+
+/* ============================================================================================ */
+
+/* number of sub-histograms that are used alternately to avoid dependencies between 
+ * successive increments of the same bin, only used for up to CARRAY_SUBHIST_MAXBINS bins */
+#define CARRAY_SUBHIST         4
+#define CARRAY_SUBHIST_MAXBINS 65536
+
+/**
+ * histogram: counts the elements in the range lo to hi into nbins bins of equal width, 
+ *            the last bin includes hi. Other values and NaN are ignored.
+ * bincount:  counts the elements, i.e. h[v] is incremented for each element value v.
+ * binsum:    sums up the weights w for the elements, i.e. h[v] += w[i]. 
+ * 
+ * h contains CARRAY_SUBHIST pointers to the sub-histograms, they may be the same.
+ */
+#define CARRAY_HISTOGRAM_KERNELS(E, T, U, N) \
+    static void histogram_##N(const T* a, size_t n, double lo, double hi, size_t nbins, MaxUInt** h) \
+    { \
+        const double scale = nbins / (hi - lo); \
+        size_t       i; \
+        for (i = 0; i < n; ++i) { \
+            double v = a[i]; \
+            if (v >= lo && v <= hi) { \
+                size_t b = (size_t)((v - lo) * scale); \
+                h[i % CARRAY_SUBHIST][(b < nbins) ? b : nbins - 1] += 1; \
+            } \
+        } \
+    }
+
+#define CARRAY_BINCOUNT_KERNELS(E, T, U, N) \
+    static void bincount_##N(const T* a, size_t n, MaxUInt** h) \
+    { \
+        MaxUInt* h0 = h[0]; \
+        MaxUInt* h1 = h[1]; \
+        MaxUInt* h2 = h[2]; \
+        MaxUInt* h3 = h[3]; \
+        size_t   i  = 0; \
+        for (; i + 4 <= n; i += 4) { \
+            h0[(U)a[i]]     += 1; \
+            h1[(U)a[i + 1]] += 1; \
+            h2[(U)a[i + 2]] += 1; \
+            h3[(U)a[i + 3]] += 1; \
+        } \
+        for (; i < n; ++i) { \
+            h0[(U)a[i]] += 1; \
+        } \
+    } \
+    static void binsum_##N(const T* a, const double* w, size_t n, double* h) \
+    { \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            h[(U)a[i]] += w[i]; \
+        } \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_HISTOGRAM_KERNELS)
+CARRAY_FOR_INTEGER_TYPES(CARRAY_BINCOUNT_KERNELS)
+
+/* ============================================================================================ */
+
+/**
+ * Pushes the result array for count elements at stack index destArg (see pushDestination()), 
+ * but the destination array may have any element type. The elements of type srcType at src 
+ * are converted into the result array.
+ */
+static void pushConverted(lua_State* L, int destArg, carray_type defaultType, 
+                          carray_type srcType, const void* src, size_t count)
+{
+    carray* dst;
+    if (lua_isnoneornil(L, destArg)) {
+        dst = pushDestination(L, destArg, defaultType, count);
+    } else {
+        dst = pushDestination(L, destArg, checkWritableUdata(L, destArg)->impl->elementType, count);
+    }
+    if (count > 0 && !convertElements(dst->elementType, dst->buffer, srcType, src, count, true)) {
+        luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+/**
+ * Allocates the sub-histograms for nbins bins as temporary userdata on the stack and sets
+ * the pointers h. For many bins only one histogram is used. Returns the number of different 
+ * sub-histograms.
+ */
+static size_t newSubHistograms(lua_State* L, size_t nbins, MaxUInt** h)
+{
+    size_t   nsub = (nbins <= CARRAY_SUBHIST_MAXBINS) ? CARRAY_SUBHIST : 1;
+    MaxUInt* base = lua_newuserdata(L, nsub * nbins * sizeof(MaxUInt));
+    size_t   j;
+    memset(base, 0, nsub * nbins * sizeof(MaxUInt));
+    for (j = 0; j < CARRAY_SUBHIST; ++j) {
+        h[j] = base + (j % nsub) * nbins;
+    }
+    return nsub;
+}
+
+/**
+ * Adds up the sub-histograms into the first one.
+ */
+static void addSubHistograms(MaxUInt** h, size_t nbins, size_t nsub)
+{
+    size_t i, j;
+    for (j = 1; j < nsub; ++j) {
+        for (i = 0; i < nbins; ++i) {
+            h[0][i] += h[j][i];
+        }
+    }
+}
+
+/* ============================================================================================ */
+
+static int Carray_histogram(lua_State* L)
+{
+    carray*     impl  = checkReadableUdata(L, 1)->impl;
+    lua_Integer nbins = luaL_checkinteger(L, 2);
+    lua_Number  lo    = luaL_checknumber(L, 3);
+    lua_Number  hi    = luaL_checknumber(L, 4);
+    if (nbins < 1) {
+        return luaL_argerror(L, 2, "positive integer expected");
+    }
+    if ((MaxUInt)nbins >= (size_t)-1 / sizeof(MaxUInt) / CARRAY_SUBHIST) {
+        return luaL_argerror(L, 2, "value too large");
+    }
+    if (!(lo < hi)) {
+        return luaL_argerror(L, 3, "lower bound must be less than upper bound");
+    }
+    if (!lua_isnoneornil(L, 5)) {
+        checkWritableUdata(L, 5);
+    }
+    lua_settop(L, 5); /* temporary histograms are pushed above dest */
+    MaxUInt*    h[CARRAY_SUBHIST];
+    size_t      nsub = newSubHistograms(L, nbins, h);
+    const void* a    = impl->buffer;
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: histogram_##N(a, impl->elementCount, lo, hi, nbins, h); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    addSubHistograms(h, nbins, nsub);
+    pushConverted(L, 5, positionType(impl->elementCount), CARRAY_MAXUINT, h[0], nbins);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_bincount(lua_State* L)
+{
+    carray* impl    = checkReadableUdata(L, 1)->impl;
+    carray* weights = NULL;
+    size_t  count   = impl->elementCount;
+    if (!impl->isInteger) {
+        return luaL_argerror(L, 1, "integer carray expected");
+    }
+    if (!lua_isnoneornil(L, 2)) {
+        weights = checkReadableUdata(L, 2)->impl;
+        if (weights->elementCount != count) {
+            return luaL_argerror(L, 2, "carray length mismatch");
+        }
+    }
+    if (!lua_isnoneornil(L, 3)) {
+        checkWritableUdata(L, 3);
+    }
+    lua_settop(L, 3); /* temporary histograms are pushed above dest */
+    carray_type resultType = weights ? CARRAY_DOUBLE : positionType(count);
+    if (count == 0) {
+        pushConverted(L, 3, resultType, resultType, NULL, 0);
+        return 1;
+    }
+    const void* a = impl->buffer;
+    size_t      nbins = 0;
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) \
+        case E: { \
+            const T       zero  = 0; \
+            const MaxUInt limit = (size_t)-1 / sizeof(MaxUInt) / CARRAY_SUBHIST; \
+            T mn, mx; \
+            minmax_##N(a, count, &mn, &mx); \
+            if (mn < zero) { \
+                return luaL_argerror(L, 1, "negative value"); \
+            } \
+            if ((MaxUInt)mx >= limit) { \
+                return luaL_argerror(L, 1, "value too large"); \
+            } \
+            nbins = (size_t)mx + 1; \
+            break; \
+        }
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    if (weights) {
+        double* h = lua_newuserdata(L, nbins * sizeof(double));
+        double  w[CARRAY_CONVERT_CHUNK];
+        size_t  i;
+        memset(h, 0, nbins * sizeof(double));
+        for (i = 0; i < count; i += CARRAY_CONVERT_CHUNK) {
+            size_t m = (count - i < CARRAY_CONVERT_CHUNK) ? count - i : CARRAY_CONVERT_CHUNK;
+            convertElements(CARRAY_DOUBLE, w, weights->elementType, weights->buffer + i * weights->elementSize, m, true);
+            switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: binsum_##N((const T*)a + i, w, m, h); break;
+                CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+                default: break;
+            }
+        }
+        pushConverted(L, 3, resultType, CARRAY_DOUBLE, h, nbins);
+    }
+    else {
+        MaxUInt* h[CARRAY_SUBHIST];
+        size_t   nsub = newSubHistograms(L, nbins, h);
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: bincount_##N(a, count, h); break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: break;
+        }
+        addSubHistograms(h, nbins, nsub);
+        pushConverted(L, 3, resultType, CARRAY_MAXUINT, h[0], nbins);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * ddot:   dot product of a and b computed in double precision using pairwise summation.
+ * dnrm2s: sum of the squares of the elements scaled by 1/m.
+ * axpy:   d[i] += alpha * x[i], compilers may use fused multiply-add for this.
+ */
+#define CARRAY_BLAS_KERNELS(E, T, U, N) \
+    static CARRAY_VECTORIZE double ddot_##N(const T* a, const T* b, size_t n) \
+    { \
+        if (n > CARRAY_PAIRWISE_BLOCK) { \
+            size_t h = (n / 2) & ~(size_t)7; \
+            return ddot_##N(a, b, h) + ddot_##N(a + h, b + h, n - h); \
+        } else { \
+            double s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0, s5 = 0, s6 = 0, s7 = 0; \
+            size_t i; \
+            for (i = 0; i + 8 <= n; i += 8) { \
+                s0 += (double)a[i]     * b[i];     s1 += (double)a[i + 1] * b[i + 1]; \
+                s2 += (double)a[i + 2] * b[i + 2]; s3 += (double)a[i + 3] * b[i + 3]; \
+                s4 += (double)a[i + 4] * b[i + 4]; s5 += (double)a[i + 5] * b[i + 5]; \
+                s6 += (double)a[i + 6] * b[i + 6]; s7 += (double)a[i + 7] * b[i + 7]; \
+            } \
+            double s = ((s0 + s1) + (s2 + s3)) + ((s4 + s5) + (s6 + s7)); \
+            for (; i < n; ++i) s += (double)a[i] * b[i]; \
+            return s; \
+        } \
+    } \
+    static CARRAY_VECTORIZE double dnrm2s_##N(const T* a, size_t n, double m) \
+    { \
+        double s = 0; \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            double v = a[i] / m; \
+            s += v * v; \
+        } \
+        return s; \
+    }
+
+#define CARRAY_AXPY(E, T, U, N) \
+    static CARRAY_VECTORIZE void axpy_##N(T* d, T alpha, const T* x, size_t n) \
+    { \
+        size_t i; \
+        for (i = 0; i < n; ++i) { \
+            d[i] += alpha * x[i]; \
+        } \
+    }
+
+CARRAY_FOR_ALL_TYPES(CARRAY_BLAS_KERNELS)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_AXPY)
+
+/* ============================================================================================ */
+
+static carray* checkFloatUdata(lua_State* L, int index, bool writable)
+{
+    carray* impl = writable ? checkWritableUdata(L, index)->impl 
+                            : checkReadableUdata(L, index)->impl;
+    if (impl->elementType != CARRAY_FLOAT && impl->elementType != CARRAY_DOUBLE) {
+        luaL_argerror(L, index, "float or double carray expected");
+    }
+    return impl;
+}
+
+static carray* checkIntegerUdata(lua_State* L, int index, bool writable)
+{
+    carray* impl = writable ? checkWritableUdata(L, index)->impl 
+                            : checkReadableUdata(L, index)->impl;
+    if (!impl->isInteger) {
+        luaL_argerror(L, index, "integer carray expected");
+    }
+    return impl;
+}
+
+/* ============================================================================================ */
+
+static int Module_dot(lua_State* L)
+{
+    carray* a = checkReadableUdata(L, 1)->impl;
+    carray* b = checkReadableUdata(L, 2)->impl;
+    if (b->elementType != a->elementType) {
+        return luaL_argerror(L, 2, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(a)));
+    }
+    if (b->elementCount != a->elementCount) {
+        return luaL_argerror(L, 2, "carray length mismatch");
+    }
+    switch (a->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: lua_pushnumber(L, ddot_##N((const T*)a->buffer, (const T*)b->buffer, a->elementCount)); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_norm2(lua_State* L)
+{
+    carray* impl = checkReadableUdata(L, 1)->impl;
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    const void* a = impl->buffer + offset * impl->elementSize;
+    double      s = 0;
+    
+    if (count > 0) {
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) \
+            case E: { \
+                s = ddot_##N(a, a, count); \
+                if (s == s && !(s >= DBL_MIN && s <= DBL_MAX)) { \
+                    /* overflow or underflow: scale by the largest absolute value */ \
+                    T mn, mx; \
+                    minmax_##N(a, count, &mn, &mx); \
+                    double m = fabs((double)mn) > fabs((double)mx) ? fabs((double)mn) : fabs((double)mx); \
+                    if (m == 0 || m > DBL_MAX) { \
+                        lua_pushnumber(L, m); \
+                        return 1; \
+                    } \
+                    lua_pushnumber(L, m * sqrt(dnrm2s_##N(a, count, m))); \
+                    return 1; \
+                } \
+                break; \
+            }
+            CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    lua_pushnumber(L, sqrt(s));
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_axpy(lua_State* L)
+{
+    carray*    impl  = checkFloatUdata(L, 1, true);
+    lua_Number alpha = luaL_checknumber(L, 2);
+    carray*    x     = checkReadableUdata(L, 3)->impl;
+    if (x->elementType != impl->elementType) {
+        return luaL_argerror(L, 3, lua_pushfstring(L, "carray type mismatch, expected: %s<%s>", CARRAY_CLASS_NAME, typeToString(impl)));
+    }
+    if (x->elementCount != impl->elementCount) {
+        return luaL_argerror(L, 3, "carray length mismatch");
+    }
+    if (impl->elementCount > 0) {
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: axpy_##N((T*)impl->buffer, (T)alpha, (const T*)x->buffer, impl->elementCount); break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_scale(lua_State* L)
+{
+    carray*    impl  = checkFloatUdata(L, 1, true);
+    lua_Number alpha = luaL_checknumber(L, 2);
+    size_t     offset, count;
+    checkRange(L, 3, impl->elementCount, &offset, &count);
+    internalArith(L, ARITH_MUL, impl, offset, impl, offset, count, NULL, 0, alpha);
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+typedef enum BitOp BitOp;
+
+enum BitOp
+{
+    BIT_AND,
+    BIT_OR,
+    BIT_XOR,
+    BIT_NOT,
+    BIT_ANDNOT,
+    BIT_SHL,
+    BIT_SHR
+};
+
+/**
+ * Elementwise bitwise operations d[i] = a[i] op b[i] or d[i] = a[i] op x if b is NULL.
+ * Shift counts are given by b[i] or s, counts that are not less than the bit width of 
+ * the element type (including negative counts) shift out all bits. Right shifts are 
+ * arithmetic for signed and logical for unsigned element types.
+ */
+#define CARRAY_BITWISE(E, T, U, N) \
+    static CARRAY_VECTORIZE void bitwise_##N(BitOp op, T* d, const T* a, const T* b, T x, MaxUInt s, size_t n) \
+    { \
+        const U bits = sizeof(T) * CHAR_BIT; \
+        const T zero = 0; \
+        size_t  i; \
+        if (b) { \
+            switch (op) { \
+                case BIT_AND: for (i = 0; i < n; ++i) d[i] = a[i] & b[i]; break; \
+                case BIT_OR:  for (i = 0; i < n; ++i) d[i] = a[i] | b[i]; break; \
+                case BIT_XOR: for (i = 0; i < n; ++i) d[i] = a[i] ^ b[i]; break; \
+                case BIT_NOT: for (i = 0; i < n; ++i) d[i] = ~a[i];       break; \
+                case BIT_ANDNOT: for (i = 0; i < n; ++i) d[i] = a[i] & ~b[i]; break; \
+                case BIT_SHL: \
+                    for (i = 0; i < n; ++i) { \
+                        U c = (U)b[i]; \
+                        d[i] = (c < bits) ? (T)((U)a[i] << c) : 0; \
+                    } \
+                    break; \
+                case BIT_SHR: \
+                    for (i = 0; i < n; ++i) { \
+                        U c = (U)b[i]; \
+                        T v = a[i]; \
+                        U k = (c < bits) ? c : bits - 1; \
+                        T r = (v < zero) ? (T)~(~v >> k) : (T)(v >> k); \
+                        d[i] = (c < bits || v < zero) ? r : 0; \
+                    } \
+                    break; \
+            } \
+        } else { \
+            switch (op) { \
+                case BIT_AND: for (i = 0; i < n; ++i) d[i] = a[i] & x; break; \
+                case BIT_OR:  for (i = 0; i < n; ++i) d[i] = a[i] | x; break; \
+                case BIT_XOR: for (i = 0; i < n; ++i) d[i] = a[i] ^ x; break; \
+                case BIT_NOT: for (i = 0; i < n; ++i) d[i] = ~a[i];    break; \
+                case BIT_ANDNOT: for (i = 0; i < n; ++i) d[i] = a[i] & ~x; break; \
+                case BIT_SHL: { \
+                    U c = (U)((s < bits) ? s : 0); \
+                    if (s < bits) { for (i = 0; i < n; ++i) d[i] = (T)((U)a[i] << c); } \
+                    else          { for (i = 0; i < n; ++i) d[i] = 0; } \
+                    break; \
+                } \
+                case BIT_SHR: { \
+                    U c = (U)((s < bits) ? s : (MaxUInt)bits - 1); \
+                    if (s < bits || (T)-1 < (T)1) { \
+                        for (i = 0; i < n; ++i) { T v = a[i]; d[i] = (v < zero) ? (T)~(~v >> c) : (T)(v >> c); } \
+                    } else { \
+                        for (i = 0; i < n; ++i) d[i] = 0; \
+                    } \
+                    break; \
+                } \
+            } \
+        } \
+    }
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_BITWISE)
+
+/* ============================================================================================ */
+
+static int bitwiseMethod(lua_State* L, BitOp op)
+{
+    carray*     impl = checkIntegerUdata(L, 1, true);
+    int         arg  = (op == BIT_NOT) ? 2 : 3;
+    size_t      offset, count;
+    checkRange(L, arg, impl->elementCount, &offset, &count);
+    lua_Integer ix = 0;
+    lua_Number  nx = 0;
+    const char* b  = (op == BIT_NOT) ? NULL : checkOperand(L, 2, impl, count, &ix, &nx);
+    if (count > 0) {
+        void* d = impl->buffer + offset * impl->elementSize;
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: bitwise_##N(op, d, d, (const T*)b, (T)ix, (MaxUInt)ix, count); break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int Carray_band(lua_State* L) { return bitwiseMethod(L, BIT_AND); }
+static int Carray_bor(lua_State* L)  { return bitwiseMethod(L, BIT_OR);  }
+static int Carray_bxor(lua_State* L) { return bitwiseMethod(L, BIT_XOR); }
+static int Carray_bnot(lua_State* L) { return bitwiseMethod(L, BIT_NOT); }
+static int Carray_bandnot(lua_State* L) { return bitwiseMethod(L, BIT_ANDNOT); }
+static int Carray_shl(lua_State* L)  { return bitwiseMethod(L, BIT_SHL); }
+static int Carray_shr(lua_State* L)  { return bitwiseMethod(L, BIT_SHR); }
+
+/* ============================================================================================ */
+
+typedef enum CompareOp CompareOp;
+
+enum CompareOp
+{
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_LE,
+    CMP_GT,
+    CMP_GE
+};
+
+/**
+ * compare:  elementwise comparison d[i] = a[i] op b[i] or d[i] = a[i] op x if b is NULL, 
+ *           the result is 1 or 0. Floating point elements are compared with x as double.
+ * select:   d[i] = m[i] ? a[i] : b[i], a or b may be NULL for using the value x or y.
+ * compress: copies the elements a[i] with m[i] != 0 to d and returns their number, total 
+ *           is the number of non zero mask elements. d may be the same as a.
+ */
+#define CARRAY_SELECT_KERNELS(E, T, U, N, S) \
+    static CARRAY_VECTORIZE void compare_##N(CompareOp op, unsigned char* d, const T* a, const T* b, S x, size_t n) \
+    { \
+        size_t i; \
+        if (b) { \
+            switch (op) { \
+                case CMP_EQ: for (i = 0; i < n; ++i) d[i] = (a[i] == b[i]); break; \
+                case CMP_NE: for (i = 0; i < n; ++i) d[i] = (a[i] != b[i]); break; \
+                case CMP_LT: for (i = 0; i < n; ++i) d[i] = (a[i] <  b[i]); break; \
+                case CMP_LE: for (i = 0; i < n; ++i) d[i] = (a[i] <= b[i]); break; \
+                case CMP_GT: for (i = 0; i < n; ++i) d[i] = (a[i] >  b[i]); break; \
+                case CMP_GE: for (i = 0; i < n; ++i) d[i] = (a[i] >= b[i]); break; \
+            } \
+        } else { \
+            switch (op) { \
+                case CMP_EQ: for (i = 0; i < n; ++i) d[i] = (a[i] == x); break; \
+                case CMP_NE: for (i = 0; i < n; ++i) d[i] = (a[i] != x); break; \
+                case CMP_LT: for (i = 0; i < n; ++i) d[i] = (a[i] <  x); break; \
+                case CMP_LE: for (i = 0; i < n; ++i) d[i] = (a[i] <= x); break; \
+                case CMP_GT: for (i = 0; i < n; ++i) d[i] = (a[i] >  x); break; \
+                case CMP_GE: for (i = 0; i < n; ++i) d[i] = (a[i] >= x); break; \
+            } \
+        } \
+    } \
+    static CARRAY_VECTORIZE void select_##N(T* d, const unsigned char* m, const T* a, const T* b, T x, T y, size_t n) \
+    { \
+        size_t i; \
+        if      ( a &&  b) { for (i = 0; i < n; ++i) d[i] = m[i] ? a[i] : b[i]; } \
+        else if ( a && !b) { for (i = 0; i < n; ++i) d[i] = m[i] ? a[i] : y;    } \
+        else if (!a &&  b) { for (i = 0; i < n; ++i) d[i] = m[i] ? x    : b[i]; } \
+        else               { for (i = 0; i < n; ++i) d[i] = m[i] ? x    : y;    } \
+    } \
+    static size_t compress_##N(T* d, const unsigned char* m, const T* a, size_t n, size_t total) \
+    { \
+        size_t i, j = 0; \
+        for (i = 0; i < n && j < total; ++i) { \
+            d[j] = a[i]; \
+            j += (m[i] != 0); \
+        } \
+        return j; \
+    }
+
+#define CARRAY_SELECT_INTEGER(E, T, U, N) CARRAY_SELECT_KERNELS(E, T, U, N, T)
+#define CARRAY_SELECT_FLOAT(E, T, U, N)   CARRAY_SELECT_KERNELS(E, T, U, N, double)
+
+CARRAY_FOR_INTEGER_TYPES(CARRAY_SELECT_INTEGER)
+CARRAY_FOR_FLOAT_TYPES(CARRAY_SELECT_FLOAT)
+
+/* ============================================================================================ */
+
+/**
+ * Checks for a mask array with count elements at stack index arg. Masks are arrays of 
+ * element type unsigned char or signed char, non zero elements are true.
+ */
+static const unsigned char* checkMask(lua_State* L, int arg, size_t count)
+{
+    carray* mask = checkReadableUdata(L, arg)->impl;
+    if (!mask->isInteger || mask->elementSize != 1) {
+        luaL_argerror(L, arg, lua_pushfstring(L, "%s<unsigned char> expected", CARRAY_CLASS_NAME));
+    }
+    if (mask->elementCount != count) {
+        luaL_argerror(L, arg, "carray length mismatch");
+    }
+    return (const unsigned char*)mask->buffer;
+}
+
+/* ============================================================================================ */
+
+static int compareMethod(lua_State* L, CompareOp op)
+{
+    carray*     impl  = checkReadableUdata(L, 1)->impl;
+    size_t      count = impl->elementCount;
+    lua_Integer ix    = 0;
+    lua_Number  nx    = 0;
+    const void* b     = checkOperand(L, 2, impl, count, &ix, &nx);
+    carray*     dst   = pushDestination(L, 3, CARRAY_UCHAR, count);
+    if (count == 0) {
+        return 1;
+    }
+    if (!b && impl->isInteger && impl->elementSize < sizeof(lua_Integer)) {
+        lua_Integer s = saturateInteger(impl, ix);
+        if (s != ix) {
+            /* value is out of the element type's range */
+            bool above = (ix > s);
+            bool rslt  = false;
+            switch (op) {
+                case CMP_EQ: rslt = false;  break;
+                case CMP_NE: rslt = true;   break;
+                case CMP_LT: rslt = above;  break;
+                case CMP_LE: rslt = above;  break;
+                case CMP_GT: rslt = !above; break;
+                case CMP_GE: rslt = !above; break;
+            }
+            memset(dst->buffer, rslt, count);
+            return 1;
+        }
+    }
+    switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: compare_##N(op, (unsigned char*)dst->buffer, (const T*)impl->buffer, b, (T)ix, count); break;
+        CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: compare_##N(op, (unsigned char*)dst->buffer, (const T*)impl->buffer, b, nx, count); break;
+        CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: return luaL_argerror(L, 1, "unsupported element type");
+    }
+    return 1;
+}
+
+static int Carray_eq(lua_State* L) { return compareMethod(L, CMP_EQ); }
+static int Carray_ne(lua_State* L) { return compareMethod(L, CMP_NE); }
+static int Carray_lt(lua_State* L) { return compareMethod(L, CMP_LT); }
+static int Carray_le(lua_State* L) { return compareMethod(L, CMP_LE); }
+static int Carray_gt(lua_State* L) { return compareMethod(L, CMP_GT); }
+static int Carray_ge(lua_State* L) { return compareMethod(L, CMP_GE); }
+
+/* ============================================================================================ */
+
+static int Module_where(lua_State* L)
+{
+    int         typeArg = luaL_testudata(L, 2, CARRAY_CLASS_NAME) ? 2 : 3;
+    carray*     impl    = checkReadableUdata(L, typeArg)->impl;
+    size_t      count   = impl->elementCount;
+    const unsigned char* m = checkMask(L, 1, count);
+    lua_Integer ia = 0, ib = 0;
+    lua_Number  na = 0, nb = 0;
+    const void* a   = checkOperand(L, 2, impl, count, &ia, &na);
+    const void* b   = checkOperand(L, 3, impl, count, &ib, &nb);
+    carray*     dst = pushDestination(L, 4, impl->elementType, count);
+    if (count > 0) {
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: select_##N((T*)dst->buffer, m, a, b, (T)ia, (T)ib, count); break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: select_##N((T*)dst->buffer, m, a, b, (T)na, (T)nb, count); break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static void internalCompress(lua_State* L, carray* dst, carray* src, const unsigned char* m, size_t count, size_t total)
+{
+    if (total == 0) {
+        return;
+    }
+    switch (src->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: compress_##N((T*)dst->buffer, m, (const T*)src->buffer, count, total); break;
+        CARRAY_FOR_ALL_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+        default: luaL_argerror(L, 1, "unsupported element type");
+    }
+}
+
+static int Carray_compress(lua_State* L)
+{
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    size_t  count = impl->elementCount;
+    const unsigned char* m = checkMask(L, 2, count);
+    size_t  total = count - countof_uchar(m, count, 0);
+    lua_settop(L, 3);
+    if (!lua_isnil(L, 3)) {
+        m = separateSource(L, m, count, checkWritableUdata(L, 3)->impl);
+    }
+    carray* dst   = pushDestination(L, 3, impl->elementType, total);
+    internalCompress(L, dst, impl, m, count, total);
+    return 1;
+}
+
+static int Carray_filter(lua_State* L)
+{
+    carray* impl  = checkWritableUdata(L, 1)->impl;
+    size_t  count = impl->elementCount;
+    const unsigned char* m = checkMask(L, 2, count);
+    size_t  total = count - countof_uchar(m, count, 0);
+    if (total < count) {
+        if (!carray_is_resizable(impl)) {
+            return luaL_error(L, "resizing carray failed");
+        }
+        m = separateSource(L, m, count, impl);
+        internalCompress(L, impl, impl, m, count, total);
+        carray_resize(impl, total, 0);
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_gather(lua_State* L)
+{
+    carray*     impl    = checkReadableUdata(L, 1)->impl;
+    MaxUInt     base    = checkIndexBase(L, 4);
+    carray*     indices = checkIndices(L, 2, base, impl->elementCount);
+    const char* src     = impl->buffer;
+    lua_settop(L, 3);
+    if (!lua_isnil(L, 3) && indices->elementCount > 0) {
+        src = separateSource(L, src, impl->elementCount * impl->elementSize, checkWritableUdata(L, 3)->impl);
+    }
+    carray* dst = pushDestination(L, 3, impl->elementType, indices->elementCount);
+    if (indices->elementCount > 0) {
+        internalGather(L, dst->buffer, src, impl->elementSize, indices, base);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_scatter(lua_State* L)
+{
+    carray*     impl    = checkWritableUdata(L, 1)->impl;
+    MaxUInt     base    = checkIndexBase(L, 4);
+    carray*     indices = checkIndices(L, 2, base, impl->elementCount);
+    size_t      count   = indices->elementCount;
+    lua_Integer ix      = 0;
+    lua_Number  nx      = 0;
+    const void* src     = checkOperand(L, 3, impl, count, &ix, &nx);
+    size_t      stride  = 1;
+    unsigned char value[sizeof(MaxInt) > sizeof(double) ? sizeof(MaxInt) : sizeof(double)];
+    
+    if (!src) {
+        switch (impl->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: { T t = (T)ix; memcpy(value, &t, sizeof(t)); } break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+#define CARRAY_CASE(E, T, U, N) case E: { T t = (T)nx; memcpy(value, &t, sizeof(t)); } break;
+            CARRAY_FOR_FLOAT_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 1, "unsupported element type");
+        }
+        src    = value;
+        stride = 0;
+    } else {
+        src = separateSource(L, src, count * impl->elementSize, impl);
+    }
+    if (count > 0) {
+        switch (indices->elementType) {
+#define CARRAY_CASE(E, T, U, N) case E: scatter_##N(impl->buffer, src, stride, impl->elementSize, (const T*)indices->buffer, count, base); break;
+            CARRAY_FOR_INTEGER_TYPES(CARRAY_CASE)
+#undef  CARRAY_CASE
+            default: return luaL_argerror(L, 2, "unsupported element type");
+        }
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+/**
+ * Bit arrays: the elements of integer arrays can be used as packed bits. The bit with 
+ * 0-based number i is bit (i % 8) of the byte (i / 8) in the array's memory, i.e. the 
+ * bit numbering does not depend on the element type or the byte order of the platform.
+ */
+
+#if defined(__GNUC__)
+#  define CARRAY_POPCOUNT64(x) __builtin_popcountll(x)
+#else
+static CARRAY_INLINE int popcount64(MaxUInt x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+#  define CARRAY_POPCOUNT64(x) popcount64(x)
+#endif
+
+typedef char CarrayCheckWordSize[(sizeof(MaxUInt) == 8) ? 1 : -1];
+
+/**
+ * Returns the number of set bits in n bytes at p, the bytes are processed as 64-bit words.
+ */
+static size_t countBits(const unsigned char* p, size_t n)
+{
+    size_t  i, rslt = 0;
+    MaxUInt w;
+    for (i = 0; i + 8 <= n; i += 8) {
+        memcpy(&w, p + i, 8);
+        rslt += CARRAY_POPCOUNT64(w);
+    }
+    for (; i < n; ++i) {
+        rslt += CARRAY_POPCOUNT64((MaxUInt)p[i]);
+    }
+    return rslt;
+}
+
+/**
+ * Returns the 0-based number of the first set bit with number >= i in n bytes at p
+ * or (size_t)-1 if there is no such bit. Zero bytes are skipped as 64-bit words.
+ */
+static size_t nextSetBit(const unsigned char* p, size_t n, size_t i)
+{
+    size_t  j = i / 8;
+    MaxUInt w;
+    if (j < n) {
+        unsigned char b = p[j] & (unsigned char)(0xFF << (i % 8));
+        if (!b) {
+            ++j;
+            while (j + 8 <= n) {
+                memcpy(&w, p + j, 8);
+                if (w) {
+                    break;
+                }
+                j += 8;
+            }
+            while (j < n && !p[j]) {
+                ++j;
+            }
+            if (j == n) {
+                return (size_t)-1;
+            }
+            b = p[j];
+        }
+        i = j * 8;
+        while (!(b & 1)) {
+            b >>= 1;
+            ++i;
+        }
+        return i;
+    }
+    return (size_t)-1;
+}
+
+/**
+ * packBits:   d[i / 8] bit (i % 8) is set if m[i] != 0, the last byte is padded with zero bits.
+ * unpackBits: d[i] = 1 if bit i of p is set, otherwise 0.
+ */
+static CARRAY_VECTORIZE void packBits(unsigned char* d, const unsigned char* m, size_t n)
+{
+    size_t i, k;
+    for (i = 0; i < n / 8; ++i) {
+        const unsigned char* s = m + 8 * i;
+        d[i] = (unsigned char)( (s[0] != 0)       | ((s[1] != 0) << 1) | ((s[2] != 0) << 2) | ((s[3] != 0) << 3)
+                              | ((s[4] != 0) << 4) | ((s[5] != 0) << 5) | ((s[6] != 0) << 6) | ((s[7] != 0) << 7));
+    }
+    if (n % 8) {
+        unsigned char b = 0;
+        for (k = 0; k < n % 8; ++k) {
+            b |= (unsigned char)((m[8 * i + k] != 0) << k);
+        }
+        d[i] = b;
+    }
+}
+
+static CARRAY_VECTORIZE void unpackBits(unsigned char* d, const unsigned char* p, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; ++i) {
+        d[i] = (p[i / 8] >> (i % 8)) & 1;
+    }
+}
+
+/* ============================================================================================ */
+
+/**
+ * Returns the logical number of bits of the bit array impl: the bit length set by 
+ * array:bitlen() or array:packbits(), otherwise all bits of the elements.
+ */
+static size_t bitLength(const carray* impl)
+{
+    return impl->bitCount ? impl->bitCount : impl->elementCount * impl->elementSize * 8;
+}
+
+/**
+ * Evaluates the 1-based bit position at stack index arg for the bit array impl and 
+ * returns the 0-based bit number.
+ */
+static size_t checkBitPosition(lua_State* L, int arg, carray* impl)
+{
+    lua_Integer pos   = luaL_checkinteger(L, arg);
+    size_t      nbits = bitLength(impl);
+    if (pos < 1 || (size_t)pos > nbits) {
+        luaL_argerror(L, arg, "index out of bounds");
+    }
+    return (size_t)(pos - 1);
+}
+
+static int Carray_getbit(lua_State* L)
+{
+    carray* impl = checkIntegerUdata(L, 1, false);
+    size_t  i    = checkBitPosition(L, 2, impl);
+    lua_pushboolean(L, (((unsigned char*)impl->buffer)[i / 8] >> (i % 8)) & 1);
+    return 1;
+}
+
+static int Carray_setbit(lua_State* L)
+{
+    carray*        impl  = checkIntegerUdata(L, 1, true);
+    size_t         i     = checkBitPosition(L, 2, impl);
+    bool           value = lua_isnone(L, 3) || lua_toboolean(L, 3);
+    unsigned char* p     = (unsigned char*)impl->buffer + i / 8;
+    if (value) {
+        *p |=  (unsigned char)(1 << (i % 8));
+    } else {
+        *p &= ~(unsigned char)(1 << (i % 8));
+    }
+    lua_settop(L, 1);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_bitlen(lua_State* L)
+{
+    if (lua_isnoneornil(L, 2)) {
+        lua_pushinteger(L, bitLength(checkIntegerUdata(L, 1, false)));
+        return 1;
+    }
+    carray*     impl  = checkIntegerUdata(L, 1, true);
+    lua_Integer nbits = luaL_checkinteger(L, 2);
+    size_t      ebits = impl->elementSize * 8;
+    if (nbits < 0) {
+        return luaL_argerror(L, 2, "bit length must not be negative");
+    }
+    size_t oldCount = impl->elementCount;
+    size_t newCount = ((size_t)nbits + ebits - 1) / ebits;
+    if (newCount != oldCount && !carray_resize(impl, newCount, 0) && newCount > 0) {
+        return luaL_error(L, "resizing carray failed");
+    }
+    if (newCount > oldCount) {
+        memset(impl->buffer + oldCount * impl->elementSize, 0, (newCount - oldCount) * impl->elementSize);
+    }
+    if (newCount > 0) {
+        /* clear the unused bits of the last element */
+        unsigned char* p   = (unsigned char*)impl->buffer;
+        size_t         end = newCount * impl->elementSize;
+        size_t         j   = (size_t)nbits / 8;
+        if (nbits % 8) {
+            p[j++] &= (unsigned char)((1 << (nbits % 8)) - 1);
+        }
+        memset(p + j, 0, end - j);
+    }
+    impl->bitCount = (size_t)nbits;
+    lua_settop(L, 1);
+    return 1;
+}
+
+static int Carray_popcount(lua_State* L)
+{
+    carray* impl  = checkIntegerUdata(L, 1, false);
+    size_t  nbits = bitLength(impl);
+    size_t  offset, count;
+    checkRange(L, 2, impl->elementCount, &offset, &count);
+    const unsigned char* p = (const unsigned char*)impl->buffer;
+    size_t  first = offset * impl->elementSize;
+    size_t  last  = (offset + count) * impl->elementSize;
+    size_t  rslt  = 0;
+    if (last * 8 > nbits) {
+        /* bits after the logical bit length are not counted */
+        last = nbits / 8;
+        if (nbits % 8 && first <= last) {
+            rslt = CARRAY_POPCOUNT64((MaxUInt)(p[last] & ((1 << (nbits % 8)) - 1)));
+        }
+    }
+    if (first < last) {
+        rslt += countBits(p + first, last - first);
+    }
+    lua_pushinteger(L, rslt);
+    return 1;
+}
+
+static int Carray_nextset(lua_State* L)
+{
+    carray*     impl  = checkIntegerUdata(L, 1, false);
+    lua_Integer pos   = luaL_optinteger(L, 2, 1);
+    size_t      nbits = bitLength(impl);
+    if (pos < 1) {
+        pos = 1;
+    }
+    if ((size_t)pos <= nbits) {
+        size_t i = nextSetBit((const unsigned char*)impl->buffer, (nbits + 7) / 8, pos - 1);
+        if (i != (size_t)-1 && i < nbits) {
+            lua_pushinteger(L, i + 1);
+            return 1;
+        }
+    }
+    lua_pushnil(L);
+    return 1;
+}
+
+/* ============================================================================================ */
+
+static int Carray_packbits(lua_State* L)
+{
+    carray* impl  = checkReadableUdata(L, 1)->impl;
+    size_t  count = impl->elementCount;
+    const unsigned char* m = checkMask(L, 1, count);
+    lua_settop(L, 2);
+    if (!lua_isnil(L, 2)) {
+        m = separateSource(L, m, count, checkWritableUdata(L, 2)->impl);
+    }
+    carray* dst = pushDestination(L, 2, CARRAY_UCHAR, (count + 7) / 8);
+    if (count > 0) {
+        packBits((unsigned char*)dst->buffer, m, count);
+    }
+    dst->bitCount = count;
+    return 1;
+}
+
+static int Carray_unpackbits(lua_State* L)
+{
+    carray* impl  = checkIntegerUdata(L, 1, false);
+    size_t  nbits = bitLength(impl);
+    size_t  count = nbits;
+    if (!lua_isnoneornil(L, 2)) {
+        lua_Integer n = luaL_checkinteger(L, 2);
+        if (n < 0 || (size_t)n > nbits) {
+            return luaL_argerror(L, 2, "index out of bounds");
+        }
+        count = (size_t)n;
+    }
+    const unsigned char* p = (const unsigned char*)impl->buffer;
+    lua_settop(L, 3);
+    if (!lua_isnil(L, 3)) {
+        p = separateSource(L, p, (count + 7) / 8, checkWritableUdata(L, 3)->impl);
+    }
+    carray* dst = pushDestination(L, 3, CARRAY_UCHAR, count);
+    if (count > 0) {
+        unpackBits((unsigned char*)dst->buffer, p, count);
+    }
+    return 1;
+}
+
+/* ============================================================================================ */
+
 static int Carray_toString(lua_State* L)
 {
     CarrayUserData* udata = luaL_checkudata(L, 1, CARRAY_CLASS_NAME);
@@ -1438,7 +5486,23 @@ static int Carray_release(lua_State* L)
 
 static const luaL_Reg ModuleFunctions[] = 
 {
-    { "new",            Carray_new   },
+    { "new",            Carray_new      },
+    { "fromtable",      Module_fromtable },
+    { "add",            Module_add      },
+    { "sub",            Module_sub      },
+    { "mul",            Module_mul      },
+    { "div",            Module_div      },
+    { "clamp",          Module_clamp    },
+    { "convert",        Module_convert  },
+    { "cumsum",         Module_cumsum   },
+    { "excumsum",       Module_excumsum },
+    { "cumprod",        Module_cumprod  },
+    { "cummax",         Module_cummax   },
+    { "cummin",         Module_cummin   },
+    { "dot",            Module_dot      },
+    { "where",          Module_where    },
+    { "writev",         Module_writev   },
+    { "mmap",           Module_mmap     },
     { NULL,             NULL } /* sentinel */
 };
 
@@ -1446,24 +5510,95 @@ static const luaL_Reg CarrayMethods[] =
 {   
     { "len",        Carray_len       },
     { "get",        Carray_get       },
+    { "totable",    Carray_totable   },
     { "set",        Carray_set       },
     { "append",     Carray_append    },
     { "insert",     Carray_insert    },
     { "appendsub",  Carray_appendsub },
     { "insertsub",  Carray_insertsub },
     { "setsub",     Carray_setsub    },
+    { "fill",       Carray_fill      },
+    { "zero",       Carray_zero      },
+    { "reverse",    Carray_reverse   },
+    { "rotate",     Carray_rotate    },
     { "remove",     Carray_remove    },
     { "setlen",     Carray_setlen    },
     { "reserve",    Carray_reserve   },
     { "reset",      Carray_reset     },
     { "tostring",   Carray_getstring },
+    { "tobytes",    Carray_tobytes   },
+    { "appendbytes", Carray_appendbytes },
+    { "setbytes",   Carray_setbytes  },
     { "type",       Carray_type      },
     { "basetype",   Carray_basetype  },
     { "bitwidth",   Carray_bitwidth  },
     { "writable",   Carray_writable  },
     { "resizable",  Carray_resizable },
+    { "view",       Carray_view      },
+    { "shape",      Carray_shape     },
+    { "reshape",    Carray_reshape   },
+    { "slice",      Carray_slice     },
+    { "clone",      Carray_clone     },
+    { "ptr",        Carray_ptr       },
     { "equals",     Carray_equals    },
+    { "sum",        Carray_sum       },
+    { "mean",       Carray_mean      },
+    { "min",        Carray_min       },
+    { "max",        Carray_max       },
+    { "minmax",     Carray_minmax    },
+    { "argmin",     Carray_argmin    },
+    { "argmax",     Carray_argmax    },
+    { "sort",       Carray_sort      },
+    { "argsort",    Carray_argsort   },
+    { "permute",    Carray_permute   },
+    { "gather",     Carray_gather    },
+    { "scatter",    Carray_scatter   },
+    { "searchsorted", Carray_searchsorted },
+    { "unique",     Carray_unique    },
+    { "dedup",      Carray_dedup     },
+    { "runs",       Carray_runs      },
+    { "find",       Carray_find      },
+    { "rfind",      Carray_rfind     },
+    { "count",      Carray_count     },
+    { "cumsum",     Carray_cumsum    },
+    { "excumsum",   Carray_excumsum  },
+    { "cumprod",    Carray_cumprod   },
+    { "cummax",     Carray_cummax    },
+    { "cummin",     Carray_cummin    },
+    { "histogram",  Carray_histogram },
+    { "bincount",   Carray_bincount  },
+    { "norm2",      Carray_norm2     },
+    { "axpy",       Carray_axpy      },
+    { "scale",      Carray_scale     },
+    { "band",       Carray_band      },
+    { "bor",        Carray_bor       },
+    { "bxor",       Carray_bxor      },
+    { "bnot",       Carray_bnot      },
+    { "bandnot",    Carray_bandnot   },
+    { "shl",        Carray_shl       },
+    { "shr",        Carray_shr       },
+    { "eq",         Carray_eq        },
+    { "ne",         Carray_ne        },
+    { "lt",         Carray_lt        },
+    { "le",         Carray_le        },
+    { "gt",         Carray_gt        },
+    { "ge",         Carray_ge        },
+    { "compress",   Carray_compress  },
+    { "filter",     Carray_filter    },
+    { "getbit",     Carray_getbit    },
+    { "bitlen",     Carray_bitlen    },
+    { "setbit",     Carray_setbit    },
+    { "popcount",   Carray_popcount  },
+    { "nextset",    Carray_nextset   },
+    { "packbits",   Carray_packbits  },
+    { "unpackbits", Carray_unpackbits },
     { "appendfile", Carray_appendfile },
+    { "writefile",  Carray_writefile },
+    { "add",        Carray_add       },
+    { "sub",        Carray_sub       },
+    { "mul",        Carray_mul       },
+    { "div",        Carray_div       },
+    { "clamp",      Carray_clamp     },
     { NULL,         NULL } /* sentinel */
 };
 
@@ -0,0 +1,50 @@
+--[[
+    Access to carray elements via the LuaJIT FFI.
+    
+    local cffi = require("carray.ffi")
+    local p, n = cffi.ptr(array)   -- typed pointer to the first element and array length
+    
+    The pointer is only valid as long as the array is not resized or garbage collected
+    and must be obtained again after resizing the array.
+--]]
+
+local ffi    = require("ffi")
+local carray = require("carray")
+
+local M = {}
+
+-- C type names for element types that are not C type names
+local cTypeNames = {
+    ["float16"]  = "uint16_t",
+    ["bfloat16"] = "uint16_t",
+}
+
+local ptrTypes = {}
+
+local function ptrType(elementType)
+    local t = ptrTypes[elementType]
+    if not t then
+        t = ffi.typeof((cTypeNames[elementType] or elementType).."*")
+        ptrTypes[elementType] = t
+    end
+    return t
+end
+
+--[[
+    Returns a typed pointer to the first element of the array and the array length.
+    The pointer is indexed from 0 to length - 1. Elements of arrays with element type
+    "float16" or "bfloat16" are accessed as raw uint16_t bit patterns.
+--]]
+function M.ptr(array)
+    local p, n = array:ptr()
+    return ffi.cast(ptrType(array:type()), p), n
+end
+
+--[[
+    Returns the FFI pointer type for arrays of the given element type name.
+--]]
+function M.ptrtype(elementType)
+    return ptrType(elementType)
+end
+
+return M
@@ -12,7 +12,7 @@
 
 #define CARRAY_CAPI_ID_STRING     "_capi_carray"
 #define CARRAY_CAPI_VERSION_MAJOR   1
-#define CARRAY_CAPI_VERSION_MINOR   0
+#define CARRAY_CAPI_VERSION_MINOR   2
 #define CARRAY_CAPI_VERSION_PATCH   0
 
 #ifndef CARRAY_CAPI_IMPLEMENT_SET_CAPI
@@ -67,6 +67,10 @@ enum carray_type
     CARRAY_LLONG  = 11,
     CARRAY_ULLONG = 12,
 #endif
+
+    /* since version 1.1: 16-bit floating point numbers (IEEE 754 half precision and bfloat16) */
+    CARRAY_HALF     = 13,
+    CARRAY_BFLOAT16 = 14
 };
 
 enum carray_attr
@@ -255,6 +259,19 @@ struct carray_capi
      *                   capacity.
      */
     void  (*removeElements)(carray* a, size_t offset, size_t count, int reservePercent);
+
+    /**
+     * Since version 1.2: Gets the shape of a multi-dimensional array.
+     *
+     * dims    - receives the sizes of the first maxDims dimensions. The elements are 
+     *           stored contiguously in row-major order, i.e. the stride of a dimension 
+     *           is the product of the sizes of all following dimensions in elements.
+     * maxDims - maximal number of dimension sizes to be stored in dims.
+     *
+     * Returns the number of dimensions. Arrays without shape have one dimension
+     * with the size elementCount.
+     */
+    size_t (*getShape)(const carray* a, size_t* dims, size_t maxDims);
 };
 
 #if CARRAY_CAPI_IMPLEMENT_SET_CAPI
@@ -34,6 +34,9 @@ static carray* internalNewCarray(lua_State* L, carray_type elementType, carray_a
         case CARRAY_FLOAT:   isFloat = true; elementSize = sizeof(float); break;
         case CARRAY_DOUBLE:  isFloat = true; elementSize = sizeof(double); break;
 
+        case CARRAY_HALF:
+        case CARRAY_BFLOAT16: isFloat = true; elementSize = 2; break;
+
 #if CARRAY_CAPI_HAVE_LONG_LONG
         case CARRAY_LLONG:   isInteger = true; elementSize = sizeof(long long); break;
         case CARRAY_ULLONG:  isInteger = true; elementSize = sizeof(unsigned long long); isUnsigned = true; break;
@@ -171,10 +174,17 @@ static void releaseCarray(const carray* array)
     carray* impl = (carray*)array;
 
     if (impl && atomic_dec(&impl->usageCounter) == 0) {
+        if (impl->parent) {
+            atomic_dec(&impl->parent->viewCounter);
+            releaseCarray(impl->parent);
+            impl->parent = NULL;
+        }
+        carray_set_shape(impl, NULL, 0);
         if (impl->buffer) {
             if (impl->isRef) {
                 if (impl->releaseCallback) {
-                    impl->releaseCallback(impl->buffer, impl->elementCount);
+                    /* the element count may have been reduced, the capacity is the referenced count */
+                    impl->releaseCallback(impl->buffer, impl->elementCapacity);
                 }
             } else {
                 free(impl->buffer);
@@ -189,12 +199,174 @@ static void releaseCarray(const carray* array)
 
 /* ============================================================================================ */
 
+bool carray_is_resizable(carray* impl)
+{
+    return (!impl->isRef || impl->isShared) 
+        && !(impl->attr & CARRAY_READONLY) && atomic_get(&impl->viewCounter) == 0;
+}
+
+/* ============================================================================================ */
+
+static void shareBuffer(carray* impl, carray* owner)
+{
+    impl->isRef           = true;
+    impl->isShared        = true;
+    impl->buffer          = owner->buffer;
+    impl->elementCount    = owner->elementCount;
+    impl->elementCapacity = owner->elementCount;
+    impl->parent          = owner;
+    retainCarray(owner);
+    atomic_inc(&owner->viewCounter);
+}
+
+/* ============================================================================================ */
+
+carray* carray_new_clone(lua_State* L, carray* impl)
+{
+    carray* clone;
+    if (!impl->isShared && (!carray_is_resizable(impl) || impl->elementCount == 0 || impl->isExported)) {
+        void* data;
+        clone = internalNewCarray(L, impl->elementType, CARRAY_DEFAULT, impl->elementCount, &data, NULL, NULL);
+        if (clone && impl->elementCount > 0) {
+            memcpy(data, impl->buffer, impl->elementCount * impl->elementSize);
+        }
+    } else {
+        clone = internalNewCarray(L, impl->elementType, CARRAY_DEFAULT, 0, NULL, NULL, NULL);
+        if (!clone) {
+            return NULL;
+        }
+        if (!impl->isShared) {
+            /* the buffer is moved into a hidden owner shared by the array and its clones */
+            carray* owner = malloc(sizeof(carray));
+            if (!owner) {
+                return NULL;
+            }
+            memset(owner, 0, sizeof(carray));
+            owner->elementType     = impl->elementType;
+            owner->elementSize     = impl->elementSize;
+            owner->isInteger       = impl->isInteger;
+            owner->isUnsigned      = impl->isUnsigned;
+            owner->buffer          = impl->buffer;
+            owner->elementCount    = impl->elementCount;
+            owner->elementCapacity = impl->elementCapacity;
+            shareBuffer(impl, owner);
+        }
+        shareBuffer(clone, impl->parent);
+    }
+    if (clone && !carray_set_shape(clone, impl->dims, impl->ndims)) {
+        return NULL;
+    }
+    if (clone) {
+        clone->bitCount = impl->bitCount;
+    }
+    return clone;
+}
+
+/* ============================================================================================ */
+
+void carray_mark_exported(carray* impl)
+{
+    for (; impl; impl = impl->parent) {
+        impl->isExported = true;
+    }
+}
+
+/* ============================================================================================ */
+
+bool carray_unshare(carray* impl)
+{
+    if (impl->isShared) {
+        carray* owner = impl->parent;
+        if (atomic_get(&owner->usageCounter) == 1) {
+            /* no other clone left: take over the buffer */
+            impl->elementCapacity = owner->elementCapacity;
+            owner->buffer = NULL;
+        } else {
+            char* newBuffer = NULL;
+            if (impl->elementCount > 0) {
+                newBuffer = malloc(impl->elementCount * impl->elementSize);
+                if (!newBuffer) {
+                    return false;
+                }
+                memcpy(newBuffer, impl->buffer, impl->elementCount * impl->elementSize);
+            }
+            impl->buffer = newBuffer;
+        }
+        impl->parent   = NULL;
+        impl->isRef    = false;
+        impl->isShared = false;
+        atomic_dec(&owner->viewCounter);
+        releaseCarray(owner);
+    }
+    return true;
+}
+
+/* ============================================================================================ */
+
+carray* carray_new_view(lua_State* L, carray* parent, size_t offset, size_t count)
+{
+    if (!carray_unshare(parent)) {
+        return NULL;
+    }
+    carray* view = internalNewCarray(L, parent->elementType, parent->attr, 0, NULL, NULL, NULL);
+    if (view) {
+        view->isRef           = true;
+        view->buffer          = (count > 0) ? parent->buffer + offset * parent->elementSize : NULL;
+        view->elementCount    = count;
+        view->elementCapacity = count;
+        view->parent          = parent;
+        retainCarray(parent);
+        atomic_inc(&parent->viewCounter);
+    }
+    return view;
+}
+
+/* ============================================================================================ */
+
+bool carray_set_shape(carray* impl, const size_t* dims, size_t ndims)
+{
+    if (ndims <= 1) {
+        free(impl->dims);
+        impl->dims  = NULL;
+        impl->ndims = 0;
+        return true;
+    }
+    size_t* newDims = malloc(ndims * sizeof(size_t));
+    if (!newDims) {
+        return false;
+    }
+    memcpy(newDims, dims, ndims * sizeof(size_t));
+    free(impl->dims);
+    impl->dims  = newDims;
+    impl->ndims = ndims;
+    return true;
+}
+
+/* ============================================================================================ */
+
+static size_t getShape(const carray* array, size_t* dims, size_t maxDims)
+{
+    size_t ndims = array->ndims;
+    if (ndims == 0) {
+        if (maxDims > 0) {
+            dims[0] = array->elementCount;
+        }
+        return 1;
+    }
+    memcpy(dims, array->dims, ((maxDims < ndims) ? maxDims : ndims) * sizeof(size_t));
+    return ndims;
+}
+
+/* ============================================================================================ */
+
 static void* getWritableElementPtr(carray* impl, size_t offset, size_t count)
 {
     if (impl && !(impl->attr & CARRAY_READONLY)
              && 0 <= offset && offset < impl->elementCount
-             && 0 <  count  && offset + count <= impl->elementCount)
+             && 0 <  count  && offset + count <= impl->elementCount
+             && carray_unshare(impl))
     {
+        carray_mark_exported(impl);
         return impl->buffer + offset * impl->elementSize;;
     }
     return NULL;
@@ -216,9 +388,9 @@ static const void* getReadableElementPtr(const carray* array, size_t offset, siz
 
 /* ============================================================================================ */
 
-static void* resizeCarray(carray* impl, size_t newCount, int reservePercent)
+static void* internalResize(carray* impl, size_t newCount, int reservePercent)
 {
-    if (!impl->isRef && !(impl->attr & CARRAY_READONLY)) {
+    if (carray_is_resizable(impl) && carray_unshare(impl)) {
         if (newCount > 0 || reservePercent >= 0) {
             if (  (newCount <  impl->elementCapacity && reservePercent >= 0) 
                 || newCount == impl->elementCapacity) 
@@ -264,14 +436,69 @@ static void* resizeCarray(carray* impl, size_t newCount, int reservePercent)
 
 /* ============================================================================================ */
 
-static void* insertElements(carray* impl, size_t pos, size_t count, int reservePercent)
+/**
+ * Discards the information that is only valid for the current element count.
+ */
+static void countChanged(carray* impl)
 {
-    if (!impl->isRef && !(impl->attr & CARRAY_READONLY) 
+    carray_set_shape(impl, NULL, 0);
+    impl->bitCount = 0;
+}
+
+void* carray_resize(carray* impl, size_t newCount, int reservePercent)
+{
+    size_t oldCount = impl->elementCount;
+    void*  data     = internalResize(impl, newCount, reservePercent);
+    if (impl->elementCount != oldCount) {
+        countChanged(impl);
+    }
+    return data;
+}
+
+static void* resizeCarray(carray* impl, size_t newCount, int reservePercent)
+{
+    void* data = carray_resize(impl, newCount, reservePercent);
+    if (data) {
+        carray_mark_exported(impl);
+    }
+    return data;
+}
+
+/* ============================================================================================ */
+
+void carray_set_count(carray* impl, size_t count)
+{
+    if (count != impl->elementCount) {
+        impl->elementCount = count;
+        countChanged(impl);
+    }
+}
+
+/* ============================================================================================ */
+
+bool carray_reserve(carray* impl, size_t capacity)
+{
+    size_t count = impl->elementCount;
+    if (capacity <= count) {
+        return carray_is_resizable(impl);
+    }
+    if (!internalResize(impl, capacity, 0)) {
+        return false;
+    }
+    impl->elementCount = count;
+    return true;
+}
+
+/* ============================================================================================ */
+
+void* carray_insert(carray* impl, size_t pos, size_t count, int reservePercent)
+{
+    if (carray_is_resizable(impl) 
         && 0 <= pos && pos <= impl->elementCount && count > 0) 
     {
         size_t oldCount = impl->elementCount;
         size_t newCount = oldCount + count;
-        char* data = resizeCarray(impl, newCount, reservePercent);
+        char* data = carray_resize(impl, newCount, reservePercent);
         if (data) {
             char* p0 = data + pos * impl->elementSize;
             if (pos < oldCount) {
@@ -285,10 +512,22 @@ static void* insertElements(carray* impl, size_t pos, size_t count, int reserveP
 
 /* ============================================================================================ */
 
+static void* insertElements(carray* impl, size_t pos, size_t count, int reservePercent)
+{
+    void* data = carray_insert(impl, pos, count, reservePercent);
+    if (data) {
+        carray_mark_exported(impl);
+    }
+    return data;
+}
+
+/* ============================================================================================ */
+
 static void removeElements(carray* impl, size_t pos, size_t count, int reservePercent)
 {
-    if (!impl->isRef && !(impl->attr & CARRAY_READONLY) 
-        && 0 <= pos && pos <= impl->elementCount && count > 0) 
+    if (carray_is_resizable(impl) 
+        && 0 <= pos && pos <= impl->elementCount && count > 0
+        && carray_unshare(impl)) 
     {
         size_t pos2 = pos + count;
         if (pos2 > impl->elementCount) {
@@ -299,7 +538,7 @@ static void removeElements(carray* impl, size_t pos, size_t count, int reservePe
             void* p2 = impl->buffer + pos2 * impl->elementSize;
             memmove(p1, p2, (impl->elementCount - pos2) * impl->elementSize);
             size_t newCount = impl->elementCount - (pos2 - pos);
-            resizeCarray(impl, newCount, reservePercent);
+            carray_resize(impl, newCount, reservePercent);
         }
     }
 }
@@ -324,7 +563,8 @@ const carray_capi carray_capi_impl =
     getReadableElementPtr,
     resizeCarray,
     insertElements,
-    removeElements
+    removeElements,
+    getShape
 };
 
 /* ============================================================================================ */
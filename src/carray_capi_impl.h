@@ -22,10 +22,80 @@ struct carray
     char*         buffer;
     size_t        elementCount;
     size_t        elementCapacity;
+
+    carray*       parent;       /* for views and clones: the retained array owning the buffer */
+    AtomicCounter viewCounter;  /* number of views referring to this array's buffer */
+    bool          isShared;     /* clone sharing the parent's buffer until first modification */
+    bool          isExported;   /* a writable pointer to the buffer was handed out, clones copy */
+
+    size_t        ndims;        /* number of dimensions if shape was set, otherwise 0 */
+    size_t*       dims;         /* sizes of the ndims dimensions */
+
+    size_t        bitCount;     /* logical number of bits for the bit methods if set, otherwise 0 */
 };
 
 /* ============================================================================================ */
 
 extern const carray_capi carray_capi_impl;
 
+/**
+ * Creates a new carray object referring to count elements of the parent's buffer 
+ * starting at offset. The parent is retained and cannot be resized as long as the 
+ * view exists. The view cannot be resized.
+ */
+carray* carray_new_view(lua_State* L, carray* parent, size_t offset, size_t count);
+
+/**
+ * Returns true if the array can be resized, i.e. it is writable, manages its 
+ * own buffer and there are no views referring to the buffer.
+ */
+bool carray_is_resizable(carray* impl);
+
+/**
+ * Creates a new array with the same elements and pushes it onto the Lua stack. 
+ * If possible the buffer is shared between both arrays and copied on the first 
+ * modification of one of them, see carray_unshare().
+ */
+carray* carray_new_clone(lua_State* L, carray* impl);
+
+/**
+ * Marks the array and the arrays owning its buffer as exported: a writable pointer to 
+ * the buffer was handed out and can be used without notice, therefore the buffer is 
+ * not shared with clones, see carray_new_clone().
+ */
+void carray_mark_exported(carray* impl);
+
+/**
+ * Gives the array its own copy of a buffer that is shared with clones. Must be
+ * called before the elements or the length of the array are modified. Returns 
+ * false on memory allocation failure.
+ */
+bool carray_unshare(carray* impl);
+
+/**
+ * Implementation of the C API functions resizeCarray() and insertElements() without
+ * marking the array as exported, for internal use.
+ */
+void* carray_resize(carray* impl, size_t newCount, int reservePercent);
+void* carray_insert(carray* impl, size_t pos, size_t count, int reservePercent);
+
+/**
+ * Sets the element count of the array to a value within the capacity. If the count is 
+ * changed, the shape and the logical bit length are discarded.
+ */
+void carray_set_count(carray* impl, size_t count);
+
+/**
+ * Enlarges the buffer of the array to a capacity of at least capacity elements without 
+ * changing the element count. Returns false if the array cannot be resized.
+ */
+bool carray_reserve(carray* impl, size_t capacity);
+
+/**
+ * Sets the shape of the array to ndims dimensions, the product of the dimension sizes 
+ * must be the element count. ndims <= 1 removes the shape. The shape is removed if the 
+ * element count of the array is changed. Returns false on memory allocation failure.
+ */
+bool carray_set_shape(carray* impl, const size_t* dims, size_t ndims);
+
 #endif /* CARRAY_CAPI_IMPL_H */
@@ -53,6 +53,39 @@
   #endif
 #endif
 
+/* -------------------------------------------------------------------------------------------- */
+
+/**
+ * Marks functions containing simple loops over array elements. These loops
+ * are written to be auto-vectorized by the compiler, this is also requested
+ * for gcc if not enabled by the general optimization level (e.g. -O2).
+ */
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5
+  #define CARRAY_VECTORIZE __attribute__ ((optimize ("tree-vectorize")))
+#else
+  #define CARRAY_VECTORIZE
+#endif
+
+/* -------------------------------------------------------------------------------------------- */
+
+/**
+ * Inlining and memory prefetch hints for small kernel functions.
+ */
+
+#if defined(__GNUC__)
+  #define CARRAY_INLINE          inline __attribute__ ((always_inline))
+  #define CARRAY_PREFETCH(addr)  __builtin_prefetch(addr)
+#elif defined(_MSC_VER)
+  #define CARRAY_INLINE          __inline
+  #define CARRAY_PREFETCH(addr)  ((void)0)
+#else
+  #define CARRAY_INLINE          inline
+  #define CARRAY_PREFETCH(addr)  ((void)0)
+#endif
+
+/* -------------------------------------------------------------------------------------------- */
+
 #define COMPAT53_PREFIX carray_compat
 
 #include "compat-5.3.h"
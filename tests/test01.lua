@@ -845,4 +845,875 @@ do
     assert(a:tostring() == "1232345678")
 end
 PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3, 4, 5)
+    
+    a:add(10)
+    assertNlistEquals(5, nlist(a:get(1,-1)), {11,12,13,14,15})
+    
+    a:mul(2, 2, -2)
+    assertNlistEquals(5, nlist(a:get(1,-1)), {11,24,26,28,15})
+    
+    a:sub(carray.new("int"):append(1, 2, 3, 4, 5))
+    assertNlistEquals(5, nlist(a:get(1,-1)), {10,22,23,24,10})
+    
+    a:div(-1, -2, -1)
+    assertNlistEquals(5, nlist(a:get(1,-1)), {10,22,23,-24,-10})
+
+    a:clamp(0, 20)
+    assertNlistEquals(5, nlist(a:get(1,-1)), {10,20,20,0,0})
+
+    local ok, err = pcall(function() a:div(0) end)
+    assert(not ok and err:match("integer division by zero"))
+
+    local ok, err = pcall(function() a:add(1.5) end)
+    assert(not ok and err:match("bad argument %#1 to 'add' %(integer or carray expected%)"))
+
+    local ok, err = pcall(function() a:add(carray.new("int", 4)) end)
+    assert(not ok and err:match("bad argument %#1 to 'add' %(carray length mismatch%)"))
+
+    local ok, err = pcall(function() a:add(carray.new("float", 5)) end)
+    assert(not ok and err:match("bad argument %#1 to 'add' %(carray type mismatch, expected: carray%<int%>%)"))
+
+    local u = carray.new("uchar"):append(10, 200, 255)
+    u:clamp(-5, 1000)
+    assertNlistEquals(3, nlist(u:get(1,-1)), {10,200,255})
+    u:mul(2)
+    assertNlistEquals(3, nlist(u:get(1,-1)), {20,144,254})
+
+    local f = carray.new("double"):append(1, 2, 3, 4)
+    local g = carray.add(f, 0.5)
+    assertNlistEquals(4, nlist(f:get(1,-1)), {1,2,3,4})
+    assertNlistEquals(4, nlist(g:get(1,-1)), {1.5,2.5,3.5,4.5})
+    
+    local d = carray.new("double")
+    assert(carray.mul(f, g, d) == d)
+    assertNlistEquals(4, nlist(d:get(1,-1)), {1.5,5,10.5,18})
+    
+    assert(carray.clamp(d, 2, 10, d) == d)
+    assertNlistEquals(4, nlist(d:get(1,-1)), {2,5,10,10})
+    
+    f:div(2)
+    assertNlistEquals(4, nlist(f:get(1,-1)), {0.5,1,1.5,2})
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(5, -3, 9, 9, -3, 2)
+    
+    assert(a:sum() == 19)
+    assert(math.type == nil or math.type(a:sum()) == "integer")
+    assert(a:sum(2, 3) == 6)
+    assert(a:sum(-2) == -1)
+    assert(a:sum(3, 2) == 0)
+    
+    assert(a:min() == -3)
+    assert(a:max() == 9)
+    assertNlistEquals(2, nlist(a:minmax()), {-3, 9})
+    assert(a:argmin() == 2)
+    assert(a:argmax() == 3)
+    assert(a:argmin(3) == 5)
+    assert(a:argmax(-3, -1) == 4)
+    
+    assert(math.abs(a:mean() - 19/6) < 1e-12)
+    assert(a:mean(1, 2) == 1)
+    
+    assert(a:mean(3, 2) == nil)
+    assert(a:min(3, 2) == nil)
+    assertNlistEquals(2, nlist(a:minmax(3, 2)), {})
+    
+    local f = carray.new("double"):append(0/0, 3, -1, 0/0)
+    assertNlistEquals(2, nlist(f:minmax()), {-1, 3})
+    assert(f:argmin() == 3)
+    assert(f:argmax() == 2)
+    
+    local c = carray.new("uchar", 1000):add(255)
+    assert(c:sum() == 255000)
+    
+    local s = carray.new("float", 100000):add(0.5)
+    assert(s:sum() == 50000)
+    assert(s:mean() == 0.5)
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("double"):append(1.5, -2.7, 300, -300, 0/0)
+    
+    local b = carray.convert(a, "schar")
+    assert(b:type() == "signed char")
+    assertNlistEquals(5, nlist(b:get(1, -1)), {1, -2, 127, -128, 0})
+    
+    local c = carray.convert(a, "uchar")
+    assertNlistEquals(5, nlist(c:get(1, -1)), {1, 0, 255, 0, 0})
+    
+    local i = carray.new("int"):append(1000, -1, 70000)
+    local s = carray.convert(i, "short")
+    assertNlistEquals(3, nlist(s:get(1, -1)), {1000, -1, 32767})
+    local t = carray.convert(i, "ushort", 1, 0, false)
+    assertNlistEquals(3, nlist(t:get(1, -1)), {1000, 65535, 70000 - 65536})
+    
+    local f = carray.convert(carray.new("short"):append(-32768, 0, 16384), "float", 1/32768)
+    assertNlistEquals(3, nlist(f:get(1, -1)), {-1, 0, 0.5})
+    
+    local g = carray.convert(f, carray.new("short"), 32767)
+    assertNlistEquals(3, nlist(g:get(1, -1)), {-32767, 0, 16383})
+    
+    local h = carray.convert(carray.new("uchar"):append(0, 128, 255), "int", 2, -100)
+    assertNlistEquals(3, nlist(h:get(1, -1)), {-100, 156, 410})
+    
+    local u = carray.convert(carray.new("int"):append(100, 200, -3), "uchar", 2, 0, false)
+    assertNlistEquals(3, nlist(u:get(1, -1)), {200, 400 - 256, 256 - 6})
+    local v = carray.convert(carray.new("int"):append(100, 200, -3), "uchar", 2, 0, true)
+    assertNlistEquals(3, nlist(v:get(1, -1)), {200, 255, 0})
+    local w = carray.convert(carray.new("int"):append(1, 3), "float", 0.5, 0, false)
+    assertNlistEquals(2, nlist(w:get(1, -1)), {0.5, 1.5})
+    
+    local d = carray.new("int", 10)
+    assert(carray.convert(s, d) == d)
+    assert(d:len() == 3)
+    assertNlistEquals(3, nlist(d:get(1, -1)), {1000, -1, 32767})
+    
+    local x = carray.new("uchar"):append(1, 2)
+    x:appendsub(i, 1, -1)
+    assertNlistEquals(5, nlist(x:get(1, -1)), {1, 2, 255, 0, 255})
+    x:setsub(1, a, 1, 2)
+    assertNlistEquals(5, nlist(x:get(1, -1)), {1, 0, 255, 0, 255})
+    x:insertsub(2, f, -1, -1)
+    assertNlistEquals(6, nlist(x:get(1, -1)), {1, 0, 0, 255, 0, 255})
+    
+    local ok, err = pcall(function() carray.convert(a, "foo") end)
+    assert(not ok and err:match("bad argument %#2 to 'convert' %(invalid option 'foo'%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int", 10)
+    assert(a:fill(7) == a)
+    assertNlistEquals(10, nlist(a:get(1, -1)), {7, 7, 7, 7, 7, 7, 7, 7, 7, 7})
+    a:fill(-1, 2, 3)
+    assertNlistEquals(10, nlist(a:get(1, -1)), {7, -1, -1, 7, 7, 7, 7, 7, 7, 7})
+    a:zero(-2)
+    assertNlistEquals(10, nlist(a:get(1, -1)), {7, -1, -1, 7, 7, 7, 7, 7, 0, 0})
+    a:zero()
+    assertNlistEquals(10, nlist(a:get(1, -1)), {0, 0, 0, 0, 0, 0, 0, 0, 0, 0})
+    
+    a:fill(carray.new("int"):append(1, 2, 3))
+    assertNlistEquals(10, nlist(a:get(1, -1)), {1, 2, 3, 1, 2, 3, 1, 2, 3, 1})
+    a:fill(a, 5, 9)
+    assertNlistEquals(10, nlist(a:get(1, -1)), {1, 2, 3, 1, 1, 2, 3, 1, 2, 1})
+    
+    local d = carray.new("double", 1000):fill(2.5)
+    assert(d:sum() == 2500)
+    d:fill(carray.new("short"):append(-1, 1))
+    assert(d:get(999) == -1 and d:get(1000) == 1 and d:sum() == 0)
+    
+    local c = carray.new("char", 5):fill("ab")
+    assert(c:tostring() == "ababa")
+    
+    local ok, err = pcall(function() c:fill("") end)
+    assert(not ok and err:match("bad argument %#1 to 'fill' %(empty pattern%)"))
+    local ok, err = pcall(function() a:fill(1.5) end)
+    assert(not ok and err:match("bad argument %#1 to 'fill' %(integer or carray expected%)"))
+    local ok, err = pcall(function() d:fill("x") end)
+    assert(not ok and err:match("bad argument %#1 to 'fill' %(number or carray expected%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(5, -3, 9, 0, -3, 2)
+    local p = a:argsort()
+    assert(p:type() == "unsigned int")
+    assertNlistEquals(6, nlist(p:get(1, -1)), {2, 5, 4, 6, 1, 3})
+    assertNlistEquals(6, nlist(a:argsort(true):get(1, -1)), {3, 1, 6, 4, 2, 5})
+    
+    local b = carray.new("char"):append("fedcba")
+    b:permute(p)
+    assert(b:tostring() == "ebcafd")
+    
+    assert(a:sort() == a)
+    assertNlistEquals(6, nlist(a:get(1, -1)), {-3, -3, 0, 2, 5, 9})
+    a:sort(true)
+    assertNlistEquals(6, nlist(a:get(1, -1)), {9, 5, 2, 0, -3, -3})
+    
+    local f = carray.new("double"):append(1.5, 0/0, -math.huge, -2, math.huge, 0)
+    f:sort()
+    assertNlistEquals(5, nlist(f:get(1, 5)), {-math.huge, -2, 0, 1.5, math.huge})
+    assert(f:get(6) ~= f:get(6))
+    f:sort(true)
+    assertNlistEquals(5, nlist(f:get(1, 5)), {math.huge, 1.5, 0, -2, -math.huge})
+    assert(f:get(6) ~= f:get(6))
+    
+    local n = 10000
+    local u = carray.new("uint", n)
+    for i = 1, n do u:set(i, (i * 7919) % n) end
+    local q = u:argsort()
+    local v = carray.new("uint"):appendsub(u, 1, -1):permute(q)
+    u:sort()
+    assert(u:equals(v))
+    for i = 1, n do assert(u:get(i) == i - 1) end
+    
+    local ok, err = pcall(function() b:permute(carray.new("int", 6)) end)
+    assert(not ok and err:match("bad argument %#1 to 'permute' %(index out of bounds%)"))
+    local ok, err = pcall(function() b:permute(carray.new("int", 5)) end)
+    assert(not ok and err:match("bad argument %#1 to 'permute' %(carray length mismatch%)"))
+    local ok, err = pcall(function() b:permute(carray.new("float", 6)) end)
+    assert(not ok and err:match("bad argument %#1 to 'permute' %(integer carray expected%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("short"):append(-5, 1, 3, 3, 3, 9)
+    assert(a:searchsorted(-10) == 1)
+    assert(a:searchsorted(-5) == 1)
+    assert(a:searchsorted(-5, "right") == 2)
+    assert(a:searchsorted(3) == 3)
+    assert(a:searchsorted(3, "right") == 6)
+    assert(a:searchsorted(4, "left") == 6)
+    assert(a:searchsorted(10) == 7)
+    assert(a:searchsorted(100000) == 7)
+    assert(a:searchsorted(-100000, "right") == 1)
+    
+    local q = a:searchsorted(carray.new("short"):append(3, 0, 20))
+    assert(q:type() == "unsigned int")
+    assertNlistEquals(3, nlist(q:get(1, -1)), {3, 2, 7})
+    
+    local e = carray.new("double")
+    assert(e:searchsorted(1.5) == 1)
+    assert(e:searchsorted(e):len() == 0)
+    
+    local f = carray.new("double"):append(2, 0/0, -1, 0.5):sort()
+    assert(f:searchsorted(0.5) == 2)
+    assert(f:searchsorted(math.huge) == 4)
+    assert(f:searchsorted(0/0) == 4)
+    assert(f:searchsorted(0/0, "right") == 5)
+    
+    local ok, err = pcall(function() a:searchsorted(1, "middle") end)
+    assert(not ok and err:match("bad argument %#2 to 'searchsorted' %(invalid option 'middle'%)"))
+    local ok, err = pcall(function() a:searchsorted(1.5) end)
+    assert(not ok and err:match("bad argument %#1 to 'searchsorted' %(integer or carray expected%)"))
+    local ok, err = pcall(function() a:searchsorted(f) end)
+    assert(not ok and err:match("bad argument %#1 to 'searchsorted' %(carray type mismatch, expected: carray%<short%>%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("uint"):append(4, 7, 1, 7, 0, 7)
+    assert(a:find(7) == 2)
+    assert(a:find(7, 3) == 4)
+    assert(a:find(7, -1) == 6)
+    assert(a:find(7, 7) == nil)
+    assert(a:find(5) == nil)
+    assert(a:find(-1) == nil)
+    assert(a:rfind(7) == 6)
+    assert(a:rfind(7, 5) == 4)
+    assert(a:rfind(7, -2) == 4)
+    assert(a:rfind(4, 0) == nil)
+    assert(a:rfind(4, 100) == 1)
+    assert(a:count(7) == 3)
+    assert(a:count(7, 3, 5) == 1)
+    assert(a:count(9) == 0)
+    
+    local c = carray.new("uchar", 1000)
+    c:set(777, 255)
+    assert(c:find(255) == 777)
+    assert(c:rfind(255) == 777)
+    assert(c:find(256) == nil)
+    assert(c:count(0) == 999)
+    
+    local f = carray.new("float"):append(0.5, 0/0, 0.1, 0.5)
+    assert(f:find(0.5, 2) == 4)
+    assert(f:find(0.1) == nil)
+    assert(f:find(0/0) == nil)
+    assert(f:count(0.5) == 2)
+    
+    local ok, err = pcall(function() a:find(1.5) end)
+    assert(not ok and err:match("bad argument %#1 to 'find'"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(3, 5, 2, 4)
+    assertNlistEquals(4, nlist(carray.cumsum(a):get(1, -1)),   {3, 8, 10, 14})
+    assertNlistEquals(4, nlist(carray.excumsum(a):get(1, -1)), {0, 3, 8, 10})
+    assertNlistEquals(4, nlist(carray.cumprod(a):get(1, -1)),  {3, 15, 30, 120})
+    assertNlistEquals(4, nlist(carray.cummax(a):get(1, -1)),   {3, 5, 5, 5})
+    assertNlistEquals(4, nlist(carray.cummin(a):get(1, -1)),   {3, 3, 2, 2})
+    assertNlistEquals(4, nlist(a:get(1, -1)), {3, 5, 2, 4})
+    
+    assert(a:cumsum(2) == a)
+    assertNlistEquals(4, nlist(a:get(1, -1)), {3, 5, 7, 11})
+    a:excumsum()
+    assertNlistEquals(4, nlist(a:get(1, -1)), {0, 3, 8, 15})
+    
+    local d = carray.new("uint", 10)
+    assert(carray.cumsum(carray.new("uint"):append(1, 2), d) == d)
+    assertNlistEquals(2, nlist(d:get(1, -1)), {1, 3})
+    
+    local u = carray.new("uchar"):append(200, 100, 1):cumsum()
+    assertNlistEquals(3, nlist(u:get(1, -1)), {200, 44, 45})
+    
+    local f = carray.new("double"):append(0/0, 1, 0/0, 3, 2):cummax()
+    assert(f:get(1) ~= f:get(1))
+    assertNlistEquals(4, nlist(f:get(2, -1)), {1, 1, 3, 3})
+    
+    local e = carray.new("float"):cumsum()
+    assert(e:len() == 0)
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("uchar"):append(3, 0, 3, 255, 7, 3)
+    local h = a:bincount()
+    assert(h:type() == "unsigned int")
+    assert(h:len() == 256)
+    assert(h:get(1) == 1 and h:get(4) == 3 and h:get(8) == 1 and h:get(256) == 1)
+    assert(h:sum() == 6)
+    
+    local g = a:histogram(4, 0, 256)
+    assertNlistEquals(4, nlist(g:get(1, -1)), {5, 0, 0, 1})
+    
+    local d = carray.new("double", 10)
+    assert(a:histogram(2, 0, 7, d) == d)
+    assertNlistEquals(2, nlist(d:get(1, -1)), {4, 1})
+    
+    local f = carray.new("float"):append(-1, 0, 0.5, 1, 0/0, 0.99)
+    assertNlistEquals(4, nlist(f:histogram(4, 0, 1):get(1, -1)), {1, 0, 1, 2})
+    
+    local b = carray.new("int"):append(2, 0, 2, 5)
+    local w = carray.new("float"):append(0.5, 1, 0.25, 2)
+    assertNlistEquals(6, nlist(b:bincount(w):get(1, -1)), {1, 0, 0.75, 0, 0, 2})
+    local c = carray.new("int")
+    assert(b:bincount(nil, c) == c)
+    assertNlistEquals(6, nlist(c:get(1, -1)), {1, 0, 2, 0, 0, 1})
+    
+    local ok, err = pcall(function() f:bincount() end)
+    assert(not ok and err:match("integer carray expected"))
+    local ok, err = pcall(function() carray.new("int"):append(-1):bincount() end)
+    assert(not ok and err:match("negative value"))
+    local ok, err = pcall(function() f:histogram(0, 0, 1) end)
+    assert(not ok and err:match("bad argument %#1 to 'histogram' %(positive integer expected%)"))
+    local ok, err = pcall(function() f:histogram(4, 1, 1) end)
+    assert(not ok and err:match("bad argument %#2 to 'histogram' %(lower bound must be less than upper bound%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("double"):append(1, 2, 3)
+    local b = carray.new("double"):append(4, -5, 6)
+    assert(carray.dot(a, b) == 12)
+    assert(math.abs(a:norm2() - math.sqrt(14)) < 1e-15)
+    assert(a:norm2(2, 2) == 2)
+    
+    assert(a:axpy(2, b) == a)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {9, -8, 15})
+    assert(a:scale(0.5, 2) == a)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {9, -4, 7.5})
+    
+    local big = carray.new("double"):append(3e200, -4e200)
+    assert(math.abs(big:norm2() / 5e200 - 1) < 1e-15)
+    local tiny = carray.new("double"):append(3e-200, 4e-200)
+    assert(math.abs(tiny:norm2() / 5e-200 - 1) < 1e-15)
+    assert(carray.new("float", 3):norm2() == 0)
+    
+    local i = carray.new("int"):append(3, 4)
+    assert(i:norm2() == 5)
+    assert(carray.dot(i, i) == 25)
+    
+    local ok, err = pcall(function() i:scale(2) end)
+    assert(not ok and err:match("float or double carray expected"))
+    local ok, err = pcall(function() a:axpy(2, carray.new("float", 3)) end)
+    assert(not ok and err:match("bad argument %#2 to 'axpy' %(carray type mismatch, expected: carray%<double%>%)"))
+    local ok, err = pcall(function() carray.dot(a, carray.new("double", 2)) end)
+    assert(not ok and err:match("bad argument %#2 to 'dot' %(carray length mismatch%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("uint"):append(0xF0F0, 0x1234, 0xFFFFFFFF)
+    assert(a:band(0xFF00) == a)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {0xF000, 0x1200, 0xFF00})
+    a:bor(1, 2, 3)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {0xF000, 0x1201, 0xFF01})
+    a:shr(8)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {0xF0, 0x12, 0xFF})
+    a:shl(28):bnot()
+    assertNlistEquals(3, nlist(a:get(1, -1)), {0xFFFFFFFF, 0xDFFFFFFF, 0x0FFFFFFF})
+    a:shr(32)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {0, 0, 0})
+    
+    local s = carray.new("schar"):append(-128, -1, 64, 5)
+    s:shr(carray.new("schar"):append(3, 100, 1, -1))
+    assertNlistEquals(4, nlist(s:get(1, -1)), {-16, -1, 32, 0})
+    
+    local u = carray.new("ushort"):append(0x8001, 0x00FF)
+    u:bxor(carray.new("ushort"):append(0x0FF0, 0xFFFF))
+    assertNlistEquals(2, nlist(u:get(1, -1)), {0x8FF1, 0xFF00})
+    
+    local p = carray.new("uchar"):append(0x12, 0x34)
+    p:shl(4, 1, 1):bor(carray.new("uchar"):append(0x03, 0))
+    assertNlistEquals(2, nlist(p:get(1, -1)), {0x23, 0x34})
+    
+    local ok, err = pcall(function() carray.new("float", 1):band(1) end)
+    assert(not ok and err:match("integer carray expected"))
+    local ok, err = pcall(function() u:band(1.5) end)
+    assert(not ok and err:match("bad argument %#1 to 'band' %(integer or carray expected%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("short"):append(5, -3, 7, 0, 5)
+    local m = a:gt(4)
+    assert(m:type() == "unsigned char")
+    assertNlistEquals(5, nlist(m:get(1, -1)), {1, 0, 1, 0, 1})
+    assertNlistEquals(5, nlist(a:lt(100000):get(1, -1)), {1, 1, 1, 1, 1})
+    assertNlistEquals(5, nlist(a:ge(100000):get(1, -1)), {0, 0, 0, 0, 0})
+    assertNlistEquals(5, nlist(a:eq(carray.new("short"):append(5, 2, 3, 4, 5)):get(1, -1)), {1, 0, 0, 0, 1})
+    
+    local c = a:compress(m)
+    assertNlistEquals(3, nlist(c:get(1, -1)), {5, 7, 5})
+    
+    local b = carray.new("short"):append(1, 2, 3, 4, 5)
+    assertNlistEquals(5, nlist(carray.where(m, a, b):get(1, -1)), {5, 2, 7, 4, 5})
+    assertNlistEquals(5, nlist(carray.where(m, a, 9):get(1, -1)),  {5, 9, 7, 9, 5})
+    assertNlistEquals(5, nlist(carray.where(m, 9, b):get(1, -1)),  {9, 2, 9, 4, 9})
+    
+    assert(b:filter(m) == b)
+    assertNlistEquals(3, nlist(b:get(1, -1)), {1, 3, 5})
+    
+    local u = carray.new("unsigned char"):append(0, 9, 8, 0, 7)
+    local k = carray.new("unsigned char"):append(1, 1, 1, 1, 0)
+    assert(u:compress(k, k) == k)
+    assertNlistEquals(4, nlist(k:get(1, -1)), {0, 9, 8, 0})
+    local k = carray.new("unsigned char"):append(1, 0, 1, 1, 1)
+    assert(k:filter(k) == k)
+    assertNlistEquals(4, nlist(k:get(1, -1)), {1, 1, 1, 1})
+    
+    local d = carray.new("double"):append(0.5, -1, 0/0)
+    assertNlistEquals(3, nlist(d:le(0.5):get(1, -1)), {1, 1, 0})
+    assertNlistEquals(3, nlist(d:ne(0.5):get(1, -1)), {0, 1, 1})
+    
+    local ok, err = pcall(function() d:compress(a) end)
+    assert(not ok and err:match("bad argument %#1 to 'compress' %(carray%<unsigned char%> expected%)"))
+    local ok, err = pcall(function() b:compress(m) end)
+    assert(not ok and err:match("bad argument %#1 to 'compress' %(carray length mismatch%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("double"):append(10, 20, 30, 40)
+    local g = a:gather(carray.new("schar"):append(4, 1, 1, 3, 2))
+    assertNlistEquals(5, nlist(g:get(1, -1)), {40, 10, 10, 30, 20})
+    local q = carray.new("ullong"):append(3, 0, 2)
+    assertNlistEquals(3, nlist(a:gather(q, nil, 0):get(1, -1)), {40, 10, 30})
+    assert(a:gather(q, g, 0) == g)
+    assertNlistEquals(3, nlist(g:get(1, -1)), {40, 10, 30})
+    assert(a:gather(q, a, 0) == a)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {40, 10, 30})
+    
+    local r = carray.new("int"):append(3, 1)
+    assert(a:scatter(r, -1) == a)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {-1, 10, -1})
+    a:scatter(r, carray.new("double"):append(7, 8))
+    assertNlistEquals(3, nlist(a:get(1, -1)), {8, 10, 7})
+    a:scatter(carray.new("int"):append(2, 2), carray.new("double"):append(1, 2), 0)
+    assertNlistEquals(3, nlist(a:get(1, -1)), {8, 10, 2})
+    
+    local ok, err = pcall(function() a:gather(q) end)
+    assert(not ok and err:match("bad argument %#1 to 'gather' %(index out of bounds%)"))
+    local ok, err = pcall(function() a:scatter(carray.new("int"):append(-1), 0, 0) end)
+    assert(not ok and err:match("bad argument %#1 to 'scatter' %(index out of bounds%)"))
+    local ok, err = pcall(function() a:gather(q, nil, 2) end)
+    assert(not ok and err:match("bad argument %#3 to 'gather' %(0 or 1 expected%)"))
+    local ok, err = pcall(function() a:scatter(r, carray.new("double", 3)) end)
+    assert(not ok and err:match("bad argument %#2 to 'scatter' %(carray length mismatch%)"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(5, 3, 5, 1, 3, 3, 9)
+    local u = a:unique()
+    assertNlistEquals(4, nlist(u:get(1, -1)), {1, 3, 5, 9})
+    assertNlistEquals(7, nlist(a:get(1, -1)), {5, 3, 5, 1, 3, 3, 9})
+    
+    local v, l = a:runs()
+    assert(l:type() == "unsigned int")
+    assertNlistEquals(6, nlist(v:get(1, -1)), {5, 3, 5, 1, 3, 9})
+    assertNlistEquals(6, nlist(l:get(1, -1)), {1, 1, 1, 1, 2, 1})
+    
+    assert(a:dedup() == a)
+    assertNlistEquals(6, nlist(a:get(1, -1)), {5, 3, 5, 1, 3, 9})
+    
+    local s = carray.new("uchar"):append(1, 1, 2, 2, 2, 7)
+    assert(s:unique(s) == s)
+    assertNlistEquals(3, nlist(s:get(1, -1)), {1, 2, 7})
+    
+    local d = carray.new("double"):append(0/0, 2, 0/0, -1, 2)
+    d:unique(d)
+    assert(d:len() == 3 and d:get(1) == -1 and d:get(2) == 2 and d:get(3) ~= d:get(3))
+    
+    local e = carray.new("short")
+    assert(e:unique():len() == 0 and e:dedup():len() == 0)
+    local v, l = e:runs()
+    assert(v:len() == 0 and l:len() == 0)
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("short"):append(1, 2, 3, 4, 5)
+    assert(a:reverse() == a)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {5, 4, 3, 2, 1})
+    a:reverse(2, 3)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {5, 3, 4, 2, 1})
+    assert(a:rotate(1) == a)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {1, 5, 3, 4, 2})
+    a:rotate(-1)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {5, 3, 4, 2, 1})
+    a:rotate(7, 1, 3)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {4, 5, 3, 2, 1})
+    
+    local n = 1000
+    for _, k in ipairs{-2001, -999, -100, -1, 0, 1, 3, 100, 500, 999, 1000, 1234} do
+        local b = carray.new("llong", n)
+        for i = 1, n do b:set(i, i) end
+        b:rotate(k)
+        for i = 1, n do
+            assert(b:get(i) == (i - 1 - k) % n + 1)
+        end
+        b:reverse()
+        assert(b:get(n) == -k % n + 1)
+    end
+    
+    for _, t in ipairs{"float16", "bfloat16"} do
+        local h = carray.new(t):append(1, 2, 3)
+        assertNlistEquals(3, nlist(h:reverse():get(1, -1)), {3, 2, 1})
+        for _, k in ipairs{-300, 1, 500, 999} do
+            local b = carray.new(t, 1000)
+            for i = 1, 1000 do b:set(i, i % 256) end
+            b:rotate(k)
+            for i = 1, 1000 do
+                assert(b:get(i) == ((i - 1 - k) % 1000 + 1) % 256)
+            end
+        end
+    end
+end
+PRINT("==================================================================================")
+do
+    local h = carray.new("float16"):append(1, -2.5, 65504, 1e6, 2^-24, 0.1, 0/0)
+    assert(h:type() == "float16")
+    assertNlistEquals(6, nlist(h:get(1, 6)), {1, -2.5, 65504, math.huge, 2^-24, 0.0999755859375})
+    assert(h:get(7) ~= h:get(7))
+    
+    local b = carray.new("bfloat16"):append(1, 3.140625, 1 + 2^-8)
+    assert(b:type() == "bfloat16")
+    assertNlistEquals(3, nlist(b:get(1, -1)), {1, 3.140625, 1})
+    
+    local d = carray.new("double"):append(0.5, 2, -3, 1000)
+    local c = carray.convert(d, "float16")
+    assert(c:type() == "float16")
+    assertNlistEquals(4, nlist(c:get(1, -1)), {0.5, 2, -3, 1000})
+    assertNlistEquals(4, nlist(carray.convert(c, "int"):get(1, -1)), {0, 2, -3, 1000})
+    assertNlistEquals(4, nlist(carray.convert(c, "double", 2, 1):get(1, -1)), {2, 5, -5, 2001})
+    c:fill(0.25):set(2, 7)
+    assertNlistEquals(4, nlist(c:get(1, -1)), {0.25, 7, 0.25, 0.25})
+    
+    local f = carray.new("float", 1000)
+    for i = 1, 1000 do f:set(i, i) end
+    local g = carray.convert(f, "bfloat16")
+    assertNlistEquals(3, nlist(g:get(255, 257)), {255, 256, 256})
+    assert(carray.convert(g, "float"):get(1000) == 1000)
+    
+    local ok, err = pcall(function() c:sum() end)
+    assert(not ok and err:match("unsupported element type"))
+end
+PRINT("==================================================================================")
+do
+    local b = carray.new("ullong", 4)
+    assert(b:popcount() == 0 and b:nextset() == nil)
+    assert(b:setbit(1) == b)
+    b:setbit(70):setbit(256, true)
+    assert(b:popcount() == 3)
+    assert(b:getbit(70) == true and b:getbit(71) == false)
+    assert(b:nextset() == 1 and b:nextset(2) == 70 and b:nextset(71) == 256 and b:nextset(257) == nil)
+    b:setbit(70, false)
+    assert(b:popcount() == 2 and b:popcount(2, 3) == 0)
+    
+    local m = carray.new("uchar"):append(1, 0, 0, 1, 1, 0, 0, 0, 0, 5, 1)
+    local p = m:packbits()
+    assertNlistEquals(2, nlist(p:get(1, -1)), {0x19, 0x06})
+    assertNlistEquals(11, nlist(p:unpackbits(11):get(1, -1)), {1, 0, 0, 1, 1, 0, 0, 0, 0, 1, 1})
+    assert(p:bitlen() == 11 and p:unpackbits():len() == 11)
+    assert(m:packbits(m) == m and m:len() == 2 and m:bitlen() == 11)
+    p:bnot()
+    assert(p:popcount() == 6 and p:nextset(11) == nil)
+    local ok, err = pcall(function() p:unpackbits(12) end)
+    assert(not ok and err:match("bad argument %#1 to 'unpackbits' %(index out of bounds%)"))
+    local ok, err = pcall(function() p:getbit(12) end)
+    assert(not ok and err:match("bad argument %#1 to 'getbit' %(index out of bounds%)"))
+    p:append(0)
+    assert(p:bitlen() == 24 and p:popcount() == 11)
+    
+    local q = carray.new("ushort"):append(0xFFFF, 0xFFFF)
+    assert(q:bitlen() == 32 and q:bitlen(20) == q and q:len() == 2 and q:bitlen() == 20)
+    assertNlistEquals(2, nlist(q:get(1, -1)), {0xFFFF, 0x000F})
+    assert(q:popcount() == 20 and q:popcount(2, 2) == 4 and q:nextset(21) == nil)
+    q:bitlen(40)
+    assert(q:len() == 3 and q:bitlen() == 40 and q:popcount() == 20)
+    q:setbit(40)
+    assert(q:nextset(21) == 40 and q:clone():bitlen() == 40)
+    q:bitlen(0)
+    assert(q:len() == 0 and q:bitlen() == 0)
+    
+    local x = carray.new("uint"):append(0xFF, 0xF0F0)
+    x:bandnot(carray.new("uint"):append(0x0F, 0xFF00))
+    assertNlistEquals(2, nlist(x:get(1, -1)), {0xF0, 0xF0})
+    
+    local big = carray.new("uchar", 1000):setbit(7777)
+    assert(big:nextset(3) == 7777 and big:popcount(973, 973) == 1)
+    
+    local ok, err = pcall(function() b:getbit(257) end)
+    assert(not ok and err:match("bad argument %#1 to 'getbit' %(index out of bounds%)"))
+    local ok, err = pcall(function() carray.new("float", 1):popcount() end)
+    assert(not ok and err:match("integer carray expected"))
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3, 4, 5)
+    local v = a:view(2, 4)
+    assert(v:type() == "int" and v:len() == 3)
+    assertNlistEquals(3, nlist(v:get(1, -1)), {2, 3, 4})
+    v:set(1, 20)
+    a:set(4, 40)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {1, 20, 3, 40, 5})
+    assertNlistEquals(3, nlist(v:get(1, -1)), {20, 3, 40})
+    assert(not a:resizable() and not v:resizable())
+    local ok, err = pcall(function() a:append(6) end)
+    assert(not ok and err:match("adding elements failed"))
+    local ok, err = pcall(function() v:append(6) end)
+    assert(not ok and err:match("adding elements failed"))
+    local w = v:view(2)
+    assertNlistEquals(2, nlist(w:get(1, -1)), {3, 40})
+    assert(carray.new("double"):view():len() == 0)
+    v, w = nil, nil
+    collectgarbage()
+    assert(a:resizable())
+    a:append(6)
+    local v = a:view(-2, -1)
+    a = nil
+    collectgarbage()
+    assertNlistEquals(2, nlist(v:get(1, -1)), {5, 6})
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3, 4, 5, 6, 7, 8)
+    a:setsub(3, a:view(1, 4), 1, -1)
+    assertNlistEquals(8, nlist(a:get(1, -1)), {1, 2, 1, 2, 3, 4, 7, 8})
+    a:view(1, 6):setsub(1, a:view(3, 8), 1, -1)
+    assertNlistEquals(8, nlist(a:get(1, -1)), {1, 2, 3, 4, 7, 8, 7, 8})
+    a:fill(a:view(3, 5), 2)
+    assertNlistEquals(8, nlist(a:get(1, -1)), {1, 3, 4, 7, 3, 4, 7, 3})
+    local a   = carray.new("int"):append(1, 2, 3, 4, 5, 6, 7, 8)
+    local idx = carray.new("int"):append(2, 1)
+    a:gather(idx, a:view(1, 2))
+    assertNlistEquals(8, nlist(a:get(1, -1)), {2, 1, 3, 4, 5, 6, 7, 8})
+    a:scatter(idx, a:view(1, 2))
+    assertNlistEquals(8, nlist(a:get(1, -1)), {1, 2, 3, 4, 5, 6, 7, 8})
+    local m = carray.new("uchar"):append(1, 0, 1, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1)
+    m:packbits(m:view(9, 10))
+    assertNlistEquals(2, nlist(m:get(9, 10)), {13, 130})
+    local b = carray.new("uchar", 16)
+    b:set(1, 0x0F, 0x81)
+    b:unpackbits(16, b:view())
+    assertNlistEquals(16, nlist(b:get(1, -1)), {1, 1, 1, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1})
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3, 4, 5, 6)
+    assertNlistEquals(1, nlist(a:shape()), {6})
+    assert(a:reshape(2, -1) == a)
+    assertNlistEquals(2, nlist(a:shape()), {2, 3})
+    local r = a:slice(2)
+    assertNlistEquals(2, nlist(r:shape()), {1, 3})
+    assertNlistEquals(3, nlist(r:get(1, -1)), {4, 5, 6})
+    local ok, err = pcall(function() a:reshape(4, -1) end)
+    assert(not ok and err:match("bad argument %#1 to 'reshape' %(shape does not match array length%)"))
+    r = nil
+    collectgarbage()
+    a:append(7)
+    assertNlistEquals(1, nlist(a:shape()), {7})
+    
+    local b = carray.new("double", {2, 3, 4})
+    assert(b:len() == 24)
+    assertNlistEquals(3, nlist(b:shape()), {2, 3, 4})
+    b:reshape({-1, 4})
+    assertNlistEquals(2, nlist(b:shape()), {6, 4})
+    assert(b:slice(2, 3):len() == 8)
+    b:reshape()
+    assertNlistEquals(1, nlist(b:shape()), {24})
+    
+    local c = carray.new("int", {3, 4})
+    c:setlen(0)
+    assertNlistEquals(1, nlist(c:shape()), {0})
+    c:setlen(12)
+    assertNlistEquals(1, nlist(c:shape()), {12})
+    c:reshape(3, 4):reset():append(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12)
+    assertNlistEquals(1, nlist(c:shape()), {12})
+    c:reshape(3, 4):reserve(100)
+    assertNlistEquals(2, nlist(c:shape()), {3, 4})
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3, 4, 5)
+    local b = a:clone()
+    local c = b:clone()
+    assert(b:type() == "int" and b:equals(a) and c:equals(a))
+    b:set(1, 10)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {1, 2, 3, 4, 5})
+    assertNlistEquals(5, nlist(b:get(1, -1)), {10, 2, 3, 4, 5})
+    assertNlistEquals(5, nlist(c:get(1, -1)), {1, 2, 3, 4, 5})
+    c:append(6)
+    assert(c:len() == 6 and a:len() == 5)
+    a:fill(0)
+    assertNlistEquals(6, nlist(c:get(1, -1)), {1, 2, 3, 4, 5, 6})
+    
+    local d = carray.new("double", {2, 2}):fill(1.5)
+    local e = d:clone()
+    assertNlistEquals(2, nlist(e:shape()), {2, 2})
+    local v = e:view(2, 3)
+    v:fill(2)
+    assertNlistEquals(4, nlist(e:get(1, -1)), {1.5, 2, 2, 1.5})
+    assertNlistEquals(4, nlist(d:get(1, -1)), {1.5, 1.5, 1.5, 1.5})
+    local w = d:view()
+    local f = d:clone()
+    w:set(1, 7)
+    assert(f:get(1) == 1.5 and d:get(1) == 7)
+    
+    local g = carray.new("int"):append(1, 2, 3)
+    local p = g:ptr()
+    local h = g:clone()
+    assert(g:ptr() == p and h:equals(g))
+    if jit then
+        local ffi = require("ffi")
+        local q = ffi.cast("int*", p)
+        q[0] = 7
+        assert(g:get(1) == 7 and h:get(1) == 1)
+        local v = g:view(2, 3)
+        local r = ffi.cast("int*", v:ptr())
+        v = nil
+        collectgarbage()
+        local k = g:clone()
+        r[0] = 8
+        assert(g:get(2) == 8 and k:get(2) == 2)
+    end
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 2, 3)
+    local p, n = a:ptr()
+    assert(type(p) == "userdata" and n == 3)
+    assert(a:ptr() == p)
+    local cffi = jit and require("carray.ffi")
+    local q, m
+    if cffi then
+        q, m = cffi.ptr(a)
+    end
+    local b = a:clone()
+    assert(a:ptr() == p and b:ptr() ~= p)
+    if cffi then
+        assert(m == 3 and q[0] == 1 and q[2] == 3)
+        for i = 0, m - 1 do
+            q[i] = q[i] * 10
+        end
+        assertNlistEquals(3, nlist(a:get(1, -1)), {10, 20, 30})
+        assertNlistEquals(3, nlist(b:get(1, -1)), {1, 2, 3})
+        local d = carray.new("double", 2):fill(1.5)
+        assert(cffi.ptr(d)[1] == 1.5)
+    end
+end
+PRINT("==================================================================================")
+do
+    local a = carray.fromtable("short", {1, -2, 3, 400, 5})
+    assert(a:type() == "short" and a:len() == 5)
+    assertNlistEquals(5, nlist(a:get(1, -1)), {1, -2, 3, 400, 5})
+    local b = carray.fromtable("double", {1.5, 2.5, 3.5}, 2, 3)
+    assertNlistEquals(2, nlist(b:get(1, -1)), {2.5, 3.5})
+    assert(carray.fromtable("int", {}):len() == 0)
+    local ok, err = pcall(function() carray.fromtable("int", {1, 2, 3.5}) end)
+    assert(not ok and err:match("bad argument %#2 to 'fromtable' %(integer expected at index 3%)"))
+    
+    local t = a:totable()
+    assert(#t == 5 and t[2] == -2 and t[5] == 5)
+    local t2 = a:totable(-2, -1, t)
+    assert(t2 == t and #t == 2 and t[1] == 400 and t[2] == 5 and t[3] == nil)
+    assert(b:totable(t) == t and #t == 2 and t[1] == 2.5)
+    assert(#a:totable(3, 2) == 0)
+end
+PRINT("==================================================================================")
+do
+    local a = carray.new("int"):append(1, 0x01020304, -1)
+    local s = a:tobytes()
+    assert(#s == 12)
+    assert(carray.new("int"):appendbytes(s):equals(a))
+    assert(a:tobytes(2, 2, "big") == "\1\2\3\4")
+    assert(a:tobytes(2, 2, "little") == "\4\3\2\1")
+    local b = carray.new("int"):appendbytes("\1\2\3\4\0\0\0\0", "big")
+    assertNlistEquals(2, nlist(b:get(1, -1)), {0x01020304, 0})
+    b:setbytes(-1, "\0\0\0\5", "big")
+    assertNlistEquals(2, nlist(b:get(1, -1)), {0x01020304, 5})
+    local ok, err = pcall(function() b:appendbytes("\1\2\3") end)
+    assert(not ok and err:match("bad argument %#1 to 'appendbytes' %(string length is not a multiple of the element size%)"))
+    local ok, err = pcall(function() b:setbytes(2, "\1\2\3\4\5\6\7\8") end)
+    assert(not ok and err:match("bad argument %#2 to 'setbytes' %(string exceeds array length%)"))
+    
+    local d = carray.new("double"):append(1.5, -2.25)
+    local e = carray.new("double"):appendbytes(d:tobytes(nil, nil, "big"), "big")
+    assert(e:equals(d))
+    assert(carray.new("float"):tobytes() == "")
+end
+PRINT("==================================================================================")
+do
+    local fname = os.tmpname()
+    local a = carray.new("int"):append(1, 2, 3, 4)
+    assert(a:writefile(fname) == 4)
+    local b = carray.new("int")
+    assert(b:appendfile(fname) == 4 and b:equals(a))
+    assert(a:writefile(fname, 2, 3, true) == 2)
+    b:reset():appendfile(fname)
+    assertNlistEquals(2, nlist(b:get(1, -1)), {2, 3})
+    
+    local d = carray.new("double"):append(2.5)
+    local f = io.open(fname, "wb")
+    assert(carray.writev(f, a, carray.new("char"), d) == 24)
+    f:close()
+    local c = carray.new("char")
+    assert(c:appendfile(fname) == 24)
+    assert(c:tostring(1, 16) == a:tobytes() and c:tostring(17, 24) == d:tobytes())
+    os.remove(fname)
+    local ok, err = pcall(function() carray.writev("x", a) end)
+    assert(not ok and err:match("file handle or descriptor expected"))
+end
+PRINT("==================================================================================")
+if package.config:sub(1, 1) == "/" then
+    local fname = os.tmpname()
+    local a = carray.new("int"):append(1, 2, 3, 4, 5)
+    a:writefile(fname)
+    local m = carray.mmap(fname, "int")
+    assert(m:len() == 5 and not m:writable() and not m:resizable())
+    assert(m:equals(a))
+    local ok, err = pcall(function() m:set(1, 10) end)
+    assert(not ok and err:match("carray is not writable"))
+    local w = carray.mmap(fname, "int", "w", 4, 3)
+    assertNlistEquals(3, nlist(w:get(1, -1)), {2, 3, 4})
+    w:set(2, 30)
+    assert(m:get(3) == 30)
+    w, m = nil, nil
+    collectgarbage()
+    assertNlistEquals(5, nlist(carray.mmap(fname, "int"):get(1, -1)), {1, 2, 30, 4, 5})
+    local ok, err = pcall(function() carray.mmap(fname, "int", "r", 2) end)
+    assert(not ok and err:match("offset must be a non%-negative multiple of the element size"))
+    local ok, err = pcall(function() carray.mmap(fname, "int", "r", 8, 4) end)
+    assert(not ok and err:match("range exceeds file size"))
+    local function mapped()
+        local f = io.open("/proc/self/maps")
+        if not f then return false end
+        local s = f:read("*a"); f:close()
+        return s:find(fname, 1, true) ~= nil
+    end
+    local w1, w2 = carray.mmap(fname, "int", "w"), carray.mmap(fname, "int", "w", 0, 4)
+    w1:setlen(2)
+    w2:reset()
+    assert(w1:len() == 2 and w2:len() == 0)
+    assertNlistEquals(2, nlist(w1:get(1, -1)), {1, 2})
+    w1, w2 = nil, nil
+    collectgarbage()
+    collectgarbage()
+    assert(not mapped())
+    os.remove(fname)
+end
+PRINT("==================================================================================")
 print("test01 OK.")